@@ -4,18 +4,158 @@
 #include <iomanip>
 #include <ctime>
 #include <map>
+#include <memory>
+#include <list>
+#include <deque>
+#include <exception>
+#include <array>
+#include <unordered_map>
+#include <unordered_set>
 #include <algorithm>
 #include <limits>
-#include <conio.h>
 #include <fstream>
 #include <sstream>
 #include <stdexcept>
 #include <cmath>
 #include <filesystem>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <thread>
+#include <condition_variable>
+#include <future>
+#include <functional>
+#include <cstdint>
+#include <string_view>
+#include <charconv>
+#include <cstring>
+#include <cstddef>
+#if defined(__x86_64__) || defined(_M_X64)
+#define PFM_X86_64 1
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#define PFM_TARGET_AVX2
+#else
+#define PFM_TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+#endif
+#ifdef _WIN32
+#include <conio.h>
+#include <fcntl.h>
+#include <io.h>
+#include <process.h>
+#include <sys/stat.h>
+#else
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <termios.h>
+#include <unistd.h>
+#endif
+
+using EntityId = uint64_t;
+
+// Generates unique, time-ordered 64-bit ids in the style of Snowflake:
+//   41 bits  milliseconds since ID_EPOCH_MS
+//   10 bits  node id (distinguishes processes sharing a data directory)
+//   12 bits  per-millisecond sequence
+// Generation is lock-free. When a millisecond's sequence is exhausted, or the
+// clock steps backwards, ids continue from the last one issued so they remain
+// strictly increasing. claimNodeId() picks the node id at startup, before the
+// first id is issued.
+class IdGenerator {
+private:
+    static const uint64_t ID_EPOCH_MS = 1704067200000ULL; // 2024-01-01T00:00:00Z
+    static const int NODE_BITS = 10;
+    static const int SEQUENCE_BITS = 12;
+    static const uint64_t SEQUENCE_MASK = (1ULL << SEQUENCE_BITS) - 1;
+    static const uint64_t NODE_MASK = (1ULL << NODE_BITS) - 1;
+
+    static std::atomic<uint64_t>& lastId() {
+        static std::atomic<uint64_t> last{0};
+        return last;
+    }
+
+    static std::atomic<uint64_t>& nodeId() {
+        static std::atomic<uint64_t> node{0};
+        return node;
+    }
+
+public:
+    static void setNodeId(uint64_t node) {
+        nodeId().store(node & NODE_MASK);
+    }
+
+    // Claims a node id that no other running process sharing `directory`
+    // holds, by keeping an exclusive lock on directory/node_<id>.lock until
+    // the process exits. The search starts at a hash of the host name and
+    // pid; that hash is used as it is when no lock can be taken (on Windows,
+    // or with all ids held).
+    static uint64_t claimNodeId(const std::string& directory) {
+#ifdef _WIN32
+        uint64_t start = std::hash<std::string>()(std::to_string(_getpid())) & NODE_MASK;
+#else
+        char host[256] = {};
+        gethostname(host, sizeof(host) - 1);
+        uint64_t start = std::hash<std::string>()(std::string(host) + ":" + std::to_string(getpid())) & NODE_MASK;
+        std::error_code ec;
+        std::filesystem::create_directories(directory, ec);
+        for (uint64_t i = 0; i <= NODE_MASK; ++i) {
+            uint64_t node = (start + i) & NODE_MASK;
+            std::string path = directory + "/node_" + std::to_string(node) + ".lock";
+            int fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+            if (fd < 0) {
+                break;
+            }
+            if (flock(fd, LOCK_EX | LOCK_NB) == 0) {
+                setNodeId(node);  // fd stays open: the lock is held until exit
+                return node;
+            }
+            ::close(fd);
+        }
+#endif
+        setNodeId(start);
+        return start;
+    }
+
+    static uint64_t getNodeId() {
+        return nodeId().load(std::memory_order_relaxed);
+    }
+
+    static EntityId next() {
+        uint64_t nowMs = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::system_clock::now().time_since_epoch()).count());
+        uint64_t elapsed = nowMs > ID_EPOCH_MS ? nowMs - ID_EPOCH_MS : 0;
+        uint64_t node = nodeId().load(std::memory_order_relaxed) << SEQUENCE_BITS;
+        uint64_t candidate = (elapsed << (NODE_BITS + SEQUENCE_BITS)) | node;
+
+        std::atomic<uint64_t>& last = lastId();
+        uint64_t previous = last.load(std::memory_order_relaxed);
+        while (true) {
+            uint64_t next = candidate;
+            if (next <= previous) {
+                // Continue from the last id, but under this process's node:
+                // the last id may predate claimNodeId(), e.g. in a forked child.
+                uint64_t ms = previous >> (NODE_BITS + SEQUENCE_BITS);
+                uint64_t sequence = previous & SEQUENCE_MASK;
+                next = (ms << (NODE_BITS + SEQUENCE_BITS)) | node | (sequence + 1);
+                if (sequence == SEQUENCE_MASK || next <= previous) {
+                    next = ((ms + 1) << (NODE_BITS + SEQUENCE_BITS)) | node;
+                }
+            }
+            if (last.compare_exchange_weak(previous, next, std::memory_order_relaxed)) {
+                return next;
+            }
+        }
+    }
+};
 
 class BaseEntity {
 protected:
-    std::string id;
+    EntityId id;
     time_t createdAt;
     time_t updatedAt;
 
@@ -27,12 +167,16 @@ public:
     BaseEntity() {
         createdAt = std::time(nullptr);
         updatedAt = createdAt;
-        id = std::to_string(createdAt);
+        id = IdGenerator::next();
     }
 
+    // Used when restoring an entity from storage.
+    BaseEntity(EntityId entityId, time_t created, time_t updated)
+        : id(entityId), createdAt(created), updatedAt(updated) {}
+
     virtual ~BaseEntity() = default;
 
-    const std::string& getId() const { return id; }
+    EntityId getId() const { return id; }
     time_t getCreatedAt() const { return createdAt; }
     time_t getUpdatedAt() const { return updatedAt; }
 };
@@ -77,538 +221,5190 @@ std::string getCategoryString(SpendingCategory category) {
     }
 }
 
-class FileManager {
+template <typename T>
+bool parseNumber(std::string_view text, T& value) {
+    auto result = std::from_chars(text.data(), text.data() + text.size(), value);
+    return result.ec == std::errc() && result.ptr == text.data() + text.size();
+}
+
+// Shortest text that parses back to exactly the same double.
+inline std::string formatNumber(double value) {
+    char buffer[32];
+    auto result = std::to_chars(buffer, buffer + sizeof(buffer), value);
+    return std::string(buffer, result.ptr);
+}
+
+// Thread-safe calendar helpers. Month and day buckets are computed from the
+// local time zone; month boundaries are cached per thread so that bucketing a
+// run of timestamps from the same month is an integer range test.
+class DateUtils {
 public:
-    static void saveToFile(const std::string& filename, const std::string& content) {
-        std::ofstream file(filename);
-        if (file.is_open()) {
-            file << content;
-            file.close();
-        } else {
-            throw std::runtime_error("Unable to open file: " + filename);
+    struct MonthRange {
+        time_t start;
+        time_t end;
+        int key;
+
+        bool contains(time_t time) const {
+            return (time >= start) & (time < end);
         }
+    };
+
+    static std::tm toLocalTime(time_t time) {
+        std::tm result{};
+#ifdef _WIN32
+        localtime_s(&result, &time);
+#else
+        localtime_r(&time, &result);
+#endif
+        return result;
     }
 
-    static std::string readFromFile(const std::string& filename) {
-        std::ifstream file(filename);
-        if (file.is_open()) {
-            std::stringstream buffer;
-            buffer << file.rdbuf();
-            file.close();
-            return buffer.str();
+    // Months since January 1900.
+    static int monthKey(time_t time) {
+        thread_local MonthRange last{0, 0, 0};
+        if (!last.contains(time)) {
+            std::tm tm = toLocalTime(time);
+            last = monthRange(tm.tm_year * 12 + tm.tm_mon);
         }
-        return "";
+        return last.key;
     }
 
-    static void createDirectory(const std::string& path) {
-        std::filesystem::create_directories(path);
+    // Days from 1970-01-01 to a proleptic Gregorian date; month is 1-12.
+    static int daysFromCivil(int year, int month, int day) {
+        year -= month <= 2;
+        int era = (year >= 0 ? year : year - 399) / 400;
+        int yearOfEra = year - era * 400;
+        int dayOfYear = (153 * (month + (month > 2 ? -3 : 9)) + 2) / 5 + day - 1;
+        int dayOfEra = yearOfEra * 365 + yearOfEra / 4 - yearOfEra / 100 + dayOfYear;
+        return era * 146097 + dayOfEra - 719468;
     }
-};
 
-class Transaction : public BaseEntity {
-private:
-    double amount;
-    SpendingCategory category;
-    std::string description;
-    time_t transactionDate;
+    // Local calendar day as a count of days since 1970-01-01, so consecutive
+    // days are consecutive integers. Each thread caches the last day over the
+    // part of it that no DST shift of up to an hour can move into another day:
+    // from an hour after its nominal midnight to an hour before the next.
+    static int dayNumber(time_t time) {
+        thread_local time_t start = 0, end = 0;
+        thread_local int cached = 0;
+        if (time < start || time >= end) {
+            std::tm tm = toLocalTime(time);
+            cached = daysFromCivil(tm.tm_year + 1900, tm.tm_mon + 1, tm.tm_mday);
+            time_t midnight = time - (tm.tm_hour * 3600 + tm.tm_min * 60 + tm.tm_sec);
+            start = midnight + 3600;
+            end = midnight + 23 * 3600;
+        }
+        return cached;
+    }
 
-public:
-    Transaction(double amt, SpendingCategory cat, const std::string& desc = "")
-        : BaseEntity(), amount(amt), category(cat), description(desc) 
-        { transactionDate = std::time(nullptr); }
+    // Calendar day as YYYYMMDD.
+    static int dayKey(time_t time) {
+        std::tm tm = toLocalTime(time);
+        return (tm.tm_year + 1900) * 10000 + (tm.tm_mon + 1) * 100 + tm.tm_mday;
+    }
 
-    std::string serialize() const {
-        std::stringstream ss;
-        ss << id << "," << amount << "," << static_cast<int>(category) << ","
-           << description << "," << transactionDate << "," << createdAt << "," << updatedAt;
-        return ss.str();
+    // [start, end) epoch range of the month identified by monthKey().
+    static MonthRange monthRange(int key) {
+        std::tm first{};
+        first.tm_year = key / 12;
+        first.tm_mon = key % 12;
+        first.tm_mday = 1;
+        first.tm_isdst = -1;
+        std::tm next = first;
+        next.tm_mon += 1;
+        next.tm_isdst = -1;
+        return MonthRange{std::mktime(&first), std::mktime(&next), key};
     }
 
-    static Transaction deserialize(const std::string& data) {
-        std::stringstream ss(data);
-        std::string token;
-        std::vector<std::string> tokens;
-        
-        while (std::getline(ss, token, ',')) {
-            tokens.push_back(token);
+    // Parses YYYY-MM-DD, MM/DD/YYYY or YYYYMMDD (anything after the date,
+    // such as a time of day, is ignored) to local noon of that day.
+    static bool parseDate(std::string_view text, time_t& result) {
+        int year, month, day;
+        auto digits = [&text](size_t pos, size_t count, int& value) {
+            return pos + count <= text.size() && parseNumber(text.substr(pos, count), value);
+        };
+        if (text.size() >= 10 && text[4] == '-' && text[7] == '-') {
+            if (!digits(0, 4, year) || !digits(5, 2, month) || !digits(8, 2, day)) {
+                return false;
+            }
+        } else if (text.size() >= 10 && text[2] == '/' && text[5] == '/') {
+            if (!digits(0, 2, month) || !digits(3, 2, day) || !digits(6, 4, year)) {
+                return false;
+            }
+        } else if (!digits(0, 4, year) || !digits(4, 2, month) || !digits(6, 2, day)) {
+            return false;
+        }
+        if (month < 1 || month > 12 || day < 1 || day > 31) {
+            return false;
         }
 
-        if (tokens.size() >= 7) {
-            Transaction trans(std::stod(tokens[1]), 
-                            static_cast<SpendingCategory>(std::stoi(tokens[2])), 
-                            tokens[3]);
-            trans.id = tokens[0];
-            trans.transactionDate = std::stoll(tokens[4]);
-            trans.createdAt = std::stoll(tokens[5]);
-            trans.updatedAt = std::stoll(tokens[6]);
-            return trans;
+        // Exports are sorted by date, so consecutive rows usually share a day.
+        thread_local int lastDay = 0;
+        thread_local time_t lastTime = 0;
+        int key = year * 10000 + month * 100 + day;
+        if (key != lastDay) {
+            std::tm tm{};
+            tm.tm_year = year - 1900;
+            tm.tm_mon = month - 1;
+            tm.tm_mday = day;
+            tm.tm_hour = 12;
+            tm.tm_isdst = -1;
+            lastTime = std::mktime(&tm);
+            lastDay = key;
         }
-        throw std::runtime_error("Invalid transaction data format");
+        result = lastTime;
+        return true;
     }
 
-    double getAmount() const { return amount; }
-    SpendingCategory getCategory() const { return category; }
-    std::string getDescription() const { return description; }
-    time_t getDate() const { return transactionDate; }
-};
+    static MonthRange currentMonth() {
+        thread_local MonthRange cached{0, 0, 0};
+        time_t now = std::time(nullptr);
+        if (!cached.contains(now)) {
+            std::tm tm = toLocalTime(now);
+            cached = monthRange(tm.tm_year * 12 + tm.tm_mon);
+        }
+        return cached;
+    }
 
-class BudgetLimit {
-public:
-    SpendingCategory category;
-    double limit;
-    
-    BudgetLimit(SpendingCategory cat, double lim) : category(cat), limit(lim) {}
+    // Local midnight at the start of the day containing `time`.
+    static time_t startOfDay(time_t time) {
+        std::tm tm = toLocalTime(time);
+        tm.tm_hour = 0;
+        tm.tm_min = 0;
+        tm.tm_sec = 0;
+        tm.tm_isdst = -1;
+        return std::mktime(&tm);
+    }
 
-    std::string serialize() const {
-        return std::to_string(static_cast<int>(category)) + "," + std::to_string(limit);
+    // The given number of calendar days, ending with today.
+    static MonthRange lastDays(int days) {
+        time_t today = startOfDay(std::time(nullptr));
+        std::tm first = toLocalTime(today);
+        first.tm_mday -= days - 1;
+        first.tm_isdst = -1;
+        std::tm next = toLocalTime(today);
+        next.tm_mday += 1;
+        next.tm_isdst = -1;
+        return MonthRange{std::mktime(&first), std::mktime(&next), 0};
     }
 
-    static BudgetLimit deserialize(const std::string& data) {
-        std::stringstream ss(data);
-        std::string categoryStr, limitStr;
-        std::getline(ss, categoryStr, ',');
-        std::getline(ss, limitStr, ',');
-        return BudgetLimit(
-            static_cast<SpendingCategory>(std::stoi(categoryStr)),
-            std::stod(limitStr)
-        );
+    // Quarter 1-4 of a calendar year; key is the month key of its first month.
+    static MonthRange quarterRange(int year, int quarter) {
+        int key = (year - 1900) * 12 + (quarter - 1) * 3;
+        return MonthRange{monthRange(key).start, monthRange(key + 3).start, key};
+    }
+
+    // January 1st of this year up to the end of today.
+    static MonthRange yearToDate() {
+        std::tm tm = toLocalTime(std::time(nullptr));
+        MonthRange today = lastDays(1);
+        return MonthRange{monthRange(tm.tm_year * 12).start, today.end, tm.tm_year * 12};
     }
 };
 
-class Account : public BaseEntity {
+// All persistence goes through FileManager. Whole-file writes are atomic and
+// durable: the content is written to "<file>.tmp", fsynced, renamed over the
+// target and the containing directory is fsynced, so a crash leaves either
+// the old or the new file, never a truncated one. Appends are fsynced too.
+//
+// Writes can be deferred in two ways, and later writes to the same file are
+// coalesced while they wait:
+//   - between beginBatch() and commitBatch(), for an explicit group commit;
+//   - in write-behind mode, where a background thread flushes every
+//     interval or once enough writes are queued. flush() forces it and the
+//     remaining writes are flushed when the process exits.
+// A flush writes and fsyncs the replacement files, then applies the queued
+// writes in order (appends in place, replacements by rename, a replacement
+// queuing behind everything written before it), then fsyncs each affected
+// directory once. Writes that must be durable before another is even queued
+// are separated by flush(). When a flush fails, only the writes it had not
+// applied are queued again. Reads of a file with queued writes flush first,
+// so callers always see their own writes.
+class FileManager {
 private:
-    std::string name;
-    double balance;
-    std::vector<Transaction> transactions;
-    double monthlyBudget;
-    std::vector<BudgetLimit> categoryBudgets;
-    std::string dataPath;
+    struct FileStamp {
+        bool exists = false;
+        std::filesystem::file_time_type mtime{};
+        std::uintmax_t size = 0;
 
-    void saveTransactions() {
-        std::string filename = dataPath + "/transactions_" + id + ".txt";
-        std::stringstream ss;
-        for (const auto& trans : transactions) {
-            ss << trans.serialize() << "\n";
+        bool operator!=(const FileStamp& other) const {
+            return exists != other.exists || mtime != other.mtime || size != other.size;
         }
-        FileManager::saveToFile(filename, ss.str());
-    }
+    };
 
-    void loadTransactions() {
-        std::string filename = dataPath + "/transactions_" + id + ".txt";
-        std::string content = FileManager::readFromFile(filename);
-        std::stringstream ss(content);
-        std::string line;
-        
-        transactions.clear();
-        while (std::getline(ss, line)) {
-            if (!line.empty()) {
-                transactions.push_back(Transaction::deserialize(line));
+    struct FileState {
+        uint64_t generation = 0;
+        FileStamp stamp;
+        bool pending = false;
+    };
+
+    struct PendingWrite {
+        std::string filename;
+        std::string content;
+        bool append;
+    };
+
+    struct Registry {
+        std::mutex mutex;        // guards everything below
+        std::mutex flushMutex;   // serializes flushes so writes land in order
+        std::map<std::string, FileState> files;
+        std::vector<PendingWrite> pending;
+        size_t pendingOps = 0;
+        int batchDepth = 0;
+        bool writeBehind = false;
+        std::chrono::milliseconds flushInterval{1000};
+        size_t flushThreshold = 1000;
+        bool stopping = false;
+        std::condition_variable wakeFlusher;
+        std::thread flusher;
+
+        ~Registry() {
+            stopFlusher(*this);
+            try {
+                flushPending(*this);
+            } catch (const std::exception& e) {
+                std::cerr << "Failed to flush pending writes: " << e.what() << std::endl;
             }
         }
+    };
+
+    static Registry& registry() {
+        static Registry instance;
+        return instance;
     }
 
-    void saveBudgetLimits() {
-        std::string filename = dataPath + "/budgets_" + id + ".txt";
-        std::stringstream ss;
-        for (const auto& budget : categoryBudgets) {
-            ss << budget.serialize() << "\n";
+#ifdef PFM_FAULT_INJECTION
+public:
+    // Test hook, run before every write, fsync, rename and removal made here. Throwing
+    // from it simulates an I/O error; exiting from it simulates a crash.
+    static std::function<void(const char* operation, const std::string& filename)>& faultHook() {
+        static std::function<void(const char*, const std::string&)> hook;
+        return hook;
+    }
+
+private:
+    static void injectFault(const char* operation, const std::string& filename) {
+        if (faultHook()) {
+            faultHook()(operation, filename);
         }
-        FileManager::saveToFile(filename, ss.str());
+    }
+#else
+    static void injectFault(const char*, const std::string&) {}
+#endif
+
+    static FileStamp statFile(const std::string& filename) {
+        FileStamp stamp;
+        std::error_code ec;
+        stamp.mtime = std::filesystem::last_write_time(filename, ec);
+        if (ec) {
+            return FileStamp();
+        }
+        stamp.size = std::filesystem::file_size(filename, ec);
+        stamp.exists = !ec;
+        return stamp;
     }
 
-    void loadBudgetLimits() {
-        std::string filename = dataPath + "/budgets_" + id + ".txt";
-        std::string content = FileManager::readFromFile(filename);
-        std::stringstream ss(content);
-        std::string line;
-        
-        categoryBudgets.clear();
-        while (std::getline(ss, line)) {
-            if (!line.empty()) {
-                categoryBudgets.push_back(BudgetLimit::deserialize(line));
+    // `written`, if given, receives the number of bytes written, also when
+    // the write fails part way.
+    static void writeFile(const std::string& filename, const std::string& content, bool append,
+                          size_t* written = nullptr) {
+        injectFault("write", filename);
+#ifdef _WIN32
+        int flags = _O_WRONLY | _O_CREAT | _O_BINARY | (append ? _O_APPEND : _O_TRUNC);
+        int fd = _open(filename.c_str(), flags, _S_IREAD | _S_IWRITE);
+#else
+        int flags = O_WRONLY | O_CREAT | (append ? O_APPEND : O_TRUNC);
+        int fd = ::open(filename.c_str(), flags, 0644);
+#endif
+        if (fd < 0) {
+            throw std::runtime_error("Unable to open file: " + filename);
+        }
+        size_t localWritten = 0;
+        size_t& done = written ? *written : localWritten;
+        done = 0;
+        while (done < content.size()) {
+            size_t chunk = std::min<size_t>(content.size() - done, 1 << 30);
+#ifdef _WIN32
+            int result = _write(fd, content.data() + done, static_cast<unsigned int>(chunk));
+#else
+            ssize_t result = ::write(fd, content.data() + done, chunk);
+            if (result < 0 && errno == EINTR) {
+                continue;
             }
+#endif
+            if (result < 0) {
+#ifdef _WIN32
+                _close(fd);
+#else
+                ::close(fd);
+#endif
+                throw std::runtime_error("Unable to write file: " + filename);
+            }
+            done += static_cast<size_t>(result);
+        }
+#ifdef _WIN32
+        bool synced = _commit(fd) == 0;
+        _close(fd);
+#else
+        bool synced = ::fsync(fd) == 0;
+        ::close(fd);
+#endif
+        injectFault("sync", filename);
+        if (!synced) {
+            throw std::runtime_error("Unable to sync file: " + filename);
         }
     }
 
-public:
-    Account(const std::string& accountName, double initialBalance = 0.0, double budget = 0.0)
-        : BaseEntity(), name(accountName), balance(initialBalance), monthlyBudget(budget) {
-        dataPath = "data/accounts/" + id;
-        FileManager::createDirectory(dataPath);
-        saveTransactions();
-        saveBudgetLimits();
+    static void syncDirectory(const std::string& directory) {
+#ifndef _WIN32
+        int fd = ::open(directory.empty() ? "." : directory.c_str(), O_RDONLY);
+        if (fd >= 0) {
+            ::fsync(fd);
+            ::close(fd);
+        }
+#else
+        (void)directory;
+#endif
     }
 
-    std::vector<Transaction>& getTransactions() {
-        loadTransactions();
-        return transactions;
+    static std::string parentDirectory(const std::string& filename) {
+        return std::filesystem::path(filename).parent_path().string();
     }
 
-    void addTransaction(const Transaction& transaction) {
-        transactions.push_back(transaction);
-        balance -= transaction.getAmount();
-        updateTimestamp();
-        saveTransactions();
+    static void replaceFile(const std::string& tempName, const std::string& filename) {
+        injectFault("rename", filename);
+        std::error_code ec;
+        std::filesystem::rename(tempName, filename, ec);
+        if (ec) {
+            std::filesystem::remove(tempName, ec);
+            throw std::runtime_error("Unable to replace file: " + filename);
+        }
     }
 
-    void editTransaction(const std::string& transId, double newAmount, 
-                        SpendingCategory newCategory, const std::string& newDescription) {
-        for (auto& trans : transactions) {
-            if (trans.getId() == transId) {
-                balance += trans.getAmount();
-                
-                Transaction newTrans(newAmount, newCategory, newDescription);
-                transactions.erase(
-                    std::remove_if(transactions.begin(), transactions.end(),
-                                 [&transId](const Transaction& t) { 
-                                     return t.getId() == transId; 
-                                 }),
-                    transactions.end()
-                );
-                transactions.push_back(newTrans);
-                
-                balance -= newAmount;
-                updateTimestamp();
-                saveTransactions();
-                return;
+    static void mergeWrite(std::vector<PendingWrite>& writes, const std::string& filename,
+                           const std::string& content, bool append) {
+        auto it = std::find_if(writes.begin(), writes.end(),
+                               [&filename](const PendingWrite& write) {
+                                   return write.filename == filename;
+                               });
+        if (it == writes.end()) {
+            writes.push_back(PendingWrite{filename, content, append});
+        } else if (append) {
+            it->content += content;
+        } else {
+            // The replacement may depend on anything queued before it.
+            writes.erase(it);
+            writes.push_back(PendingWrite{filename, content, false});
+        }
+    }
+
+    // Writes directly unless writes are being deferred, or this file already
+    // has queued writes that must land first.
+    static void write(const std::string& filename, const std::string& content, bool append) {
+        Registry& r = registry();
+        bool deferred;
+        {
+            std::lock_guard<std::mutex> lock(r.mutex);
+            FileState& state = r.files[filename];
+            deferred = r.batchDepth > 0 || r.writeBehind;
+            if (deferred || state.pending) {
+                mergeWrite(r.pending, filename, content, append);
+                ++state.generation;
+                state.pending = true;
+                if (deferred) {
+                    if (r.writeBehind && ++r.pendingOps >= r.flushThreshold) {
+                        r.wakeFlusher.notify_one();
+                    }
+                    return;
+                }
             }
         }
-        throw std::runtime_error("Transaction not found");
+        std::lock_guard<std::mutex> flushLock(r.flushMutex);
+        bool queued;
+        {
+            std::lock_guard<std::mutex> lock(r.mutex);
+            queued = r.files[filename].pending;
+        }
+        if (queued) {
+            flushLocked(r);
+            return;
+        }
+        if (append) {
+            writeFile(filename, content, true);
+        } else {
+            std::string tempName = filename + ".tmp";
+            writeFile(tempName, content, false);
+            replaceFile(tempName, filename);
+            syncDirectory(parentDirectory(filename));
+        }
+        std::lock_guard<std::mutex> lock(r.mutex);
+        FileState& state = r.files[filename];
+        ++state.generation;
+        state.stamp = statFile(filename);
     }
 
-    void deleteTransaction(const std::string& transId) {
-        for (const auto& trans : transactions) {
-            if (trans.getId() == transId) {
-                balance += trans.getAmount();
-                transactions.erase(
-                    std::remove_if(transactions.begin(), transactions.end(),
-                                 [&transId](const Transaction& t) { 
-                                     return t.getId() == transId; 
-                                 }),
-                    transactions.end()
-                );
-                updateTimestamp();
-                saveTransactions();
-                return;
+    // Applies `writes` in order. On failure, `done` counts the writes fully
+    // applied, and a failed append keeps only its unwritten tail.
+    static void flushWrites(std::vector<PendingWrite>& writes, size_t& done) {
+        done = 0;
+        for (const auto& write : writes) {
+            if (!write.append) {
+                writeFile(write.filename + ".tmp", write.content, false);
+            }
+        }
+        std::vector<std::string> directories;
+        for (; done < writes.size(); ++done) {
+            PendingWrite& write = writes[done];
+            std::string directory = parentDirectory(write.filename);
+            if (write.append) {
+                size_t written = 0;
+                try {
+                    writeFile(write.filename, write.content, true, &written);
+                } catch (...) {
+                    write.content.erase(0, written);
+                    throw;
+                }
+            } else {
+                replaceFile(write.filename + ".tmp", write.filename);
+            }
+            if (std::find(directories.begin(), directories.end(), directory) == directories.end()) {
+                directories.push_back(directory);
             }
         }
-        throw std::runtime_error("Transaction not found");
+        for (const auto& directory : directories) {
+            syncDirectory(directory);
+        }
     }
 
-    void setCategoryBudget(SpendingCategory category, double limit) {
-        auto it = std::find_if(categoryBudgets.begin(), categoryBudgets.end(),
-                              [category](const BudgetLimit& budget) {
-                                  return budget.category == category;
-                              });
-        
-        if (it != categoryBudgets.end()) {
-            it->limit = limit;
-        } else {
-            categoryBudgets.push_back(BudgetLimit(category, limit));
+    // Caller holds flushMutex.
+    static void flushLocked(Registry& r) {
+        std::vector<PendingWrite> writes;
+        {
+            std::lock_guard<std::mutex> lock(r.mutex);
+            writes.swap(r.pending);
+            r.pendingOps = 0;
+        }
+        if (writes.empty()) {
+            return;
+        }
+        size_t done = 0;
+        std::exception_ptr failure;
+        try {
+            flushWrites(writes, done);
+        } catch (...) {
+            failure = std::current_exception();
+        }
+        std::lock_guard<std::mutex> lock(r.mutex);
+        if (failure) {
+            // Put the writes not applied back in front of anything queued since.
+            std::vector<PendingWrite> remaining(std::make_move_iterator(writes.begin() + done),
+                                                std::make_move_iterator(writes.end()));
+            for (const auto& newer : r.pending) {
+                mergeWrite(remaining, newer.filename, newer.content, newer.append);
+            }
+            r.pending.swap(remaining);
+        }
+        for (size_t i = 0; i < done; ++i) {
+            FileState& state = r.files[writes[i].filename];
+            state.stamp = statFile(writes[i].filename);
+            state.pending = std::any_of(r.pending.begin(), r.pending.end(),
+                                        [&writes, i](const PendingWrite& queued) {
+                                            return queued.filename == writes[i].filename;
+                                        });
+        }
+        if (failure) {
+            std::rethrow_exception(failure);
         }
-        saveBudgetLimits();
     }
 
-    void deleteCategoryBudget(SpendingCategory category) {
-        categoryBudgets.erase(
-            std::remove_if(categoryBudgets.begin(), categoryBudgets.end(),
-                          [category](const BudgetLimit& budget) {
-                              return budget.category == category;
-                          }),
-            categoryBudgets.end()
-        );
-        saveBudgetLimits();
+    static void flushPending(Registry& r) {
+        std::lock_guard<std::mutex> flushLock(r.flushMutex);
+        flushLocked(r);
     }
 
-    std::vector<BudgetLimit> getCategoryBudgets() const {
-        return categoryBudgets;
+    static void runFlusher(Registry& r) {
+        std::unique_lock<std::mutex> lock(r.mutex);
+        while (!r.stopping) {
+            r.wakeFlusher.wait_for(lock, r.flushInterval, [&r] {
+                return r.stopping || r.pendingOps >= r.flushThreshold;
+            });
+            if (r.pending.empty()) {
+                continue;
+            }
+            lock.unlock();
+            try {
+                flushPending(r);
+            } catch (const std::exception& e) {
+                std::cerr << "Background flush failed: " << e.what() << std::endl;
+            }
+            lock.lock();
+        }
     }
 
-    bool isCategoryOverBudget(SpendingCategory category) const {
-        auto it = std::find_if(categoryBudgets.begin(), categoryBudgets.end(),
-                              [category](const BudgetLimit& budget) {
-                                  return budget.category == category;
-                              });
-        
-        if (it != categoryBudgets.end()) {
-            double categorySpending = 0.0;
-            time_t now = std::time(nullptr);
-            std::tm* nowTm = std::localtime(&now);
-            
-            for (const auto& trans : transactions) {
-                if (trans.getCategory() == category) {
-                    time_t transTime = trans.getDate();
-                    std::tm* transTm = std::localtime(&transTime);
-                    
-                    if (transTm && nowTm && 
-                        transTm->tm_mon == nowTm->tm_mon && 
-                        transTm->tm_year == nowTm->tm_year) {
-                        categorySpending += trans.getAmount();
-                    }
-                }
+    static void stopFlusher(Registry& r) {
+        {
+            std::lock_guard<std::mutex> lock(r.mutex);
+            r.writeBehind = false;
+            r.stopping = true;
+        }
+        r.wakeFlusher.notify_one();
+        if (r.flusher.joinable()) {
+            r.flusher.join();
+        }
+        std::lock_guard<std::mutex> lock(r.mutex);
+        r.stopping = false;
+    }
+
+public:
+    static void saveToFile(const std::string& filename, const std::string& content) {
+        write(filename, content, false);
+    }
+
+    static void appendToFile(const std::string& filename, const std::string& content) {
+        write(filename, content, true);
+    }
+
+    // Flushes everything queued first, so the removal lands after the writes
+    // that made the file obsolete.
+    static void removeFile(const std::string& filename) {
+        Registry& r = registry();
+        flushPending(r);
+        std::lock_guard<std::mutex> flushLock(r.flushMutex);
+        injectFault("remove", filename);
+        std::error_code ec;
+        std::filesystem::remove(filename, ec);
+        if (ec) {
+            throw std::runtime_error("Unable to remove file: " + filename);
+        }
+        syncDirectory(parentDirectory(filename));
+        std::lock_guard<std::mutex> lock(r.mutex);
+        FileState& state = r.files[filename];
+        ++state.generation;
+        state.stamp = statFile(filename);
+    }
+
+    // Batches nest; the outermost commitBatch() flushes everything queued.
+    static void beginBatch() {
+        Registry& r = registry();
+        std::lock_guard<std::mutex> lock(r.mutex);
+        ++r.batchDepth;
+    }
+
+    static void commitBatch() {
+        Registry& r = registry();
+        {
+            std::lock_guard<std::mutex> lock(r.mutex);
+            if (r.batchDepth == 0 || --r.batchDepth > 0) {
+                return;
             }
-            return categorySpending > it->limit;
         }
-        return false;
+        flushPending(r);
+    }
+
+    // Defers all writes to a background thread that flushes every `interval`
+    // or as soon as `threshold` writes are queued.
+    static void enableWriteBehind(std::chrono::milliseconds interval, size_t threshold) {
+        Registry& r = registry();
+        std::lock_guard<std::mutex> lock(r.mutex);
+        r.flushInterval = interval;
+        r.flushThreshold = std::max<size_t>(threshold, 1);
+        r.writeBehind = true;
+        if (!r.flusher.joinable()) {
+            r.flusher = std::thread(runFlusher, std::ref(r));
+        }
+    }
+
+    // Stops the background thread and flushes what it left behind.
+    static void disableWriteBehind() {
+        Registry& r = registry();
+        stopFlusher(r);
+        flushPending(r);
+    }
+
+    static void flush() {
+        flushPending(registry());
+    }
+
+    static bool hasPendingWrites(const std::string& filename) {
+        Registry& r = registry();
+        std::lock_guard<std::mutex> lock(r.mutex);
+        auto it = r.files.find(filename);
+        return it != r.files.end() && it->second.pending;
     }
 
-    void deposit(double amount) {
-        if (amount > 0) {
-            balance += amount;
-            updateTimestamp();
+    // Flushes first if the file has queued writes.
+    static void ensureFlushed(const std::string& filename) {
+        Registry& r = registry();
+        bool queued;
+        {
+            std::lock_guard<std::mutex> lock(r.mutex);
+            auto it = r.files.find(filename);
+            queued = it != r.files.end() && it->second.pending;
+        }
+        if (queued) {
+            flushPending(r);
+        }
+    }
+
+    // Generation counter for a file. It changes whenever the file is written
+    // through FileManager, or when its mtime or size no longer match what was
+    // last seen (i.e. it was modified outside this process).
+    static uint64_t getGeneration(const std::string& filename) {
+        Registry& r = registry();
+        std::lock_guard<std::mutex> lock(r.mutex);
+        FileState& state = r.files[filename];
+        if (state.pending) {
+            return state.generation;
+        }
+        FileStamp current = statFile(filename);
+        if (current != state.stamp) {
+            ++state.generation;
+            state.stamp = current;
+        }
+        return state.generation;
+    }
+
+    static std::string readFromFile(const std::string& filename) {
+        ensureFlushed(filename);
+        std::ifstream file(filename);
+        if (file.is_open()) {
+            std::stringstream buffer;
+            buffer << file.rdbuf();
+            file.close();
+            return buffer.str();
+        }
+        return "";
+    }
+
+    static void createDirectory(const std::string& path) {
+        std::filesystem::create_directories(path);
+    }
+};
+
+// Read-only view of a whole file. On POSIX systems the file is memory-mapped;
+// elsewhere it is read into a single buffer.
+class MappedFile {
+private:
+    const char* mappedData = nullptr;
+    size_t mappedSize = 0;
+#ifdef _WIN32
+    std::string buffer;
+#endif
+
+public:
+    explicit MappedFile(const std::string& filename) {
+        FileManager::ensureFlushed(filename);
+#ifdef _WIN32
+        std::ifstream file(filename, std::ios::binary);
+        if (file.is_open()) {
+            std::stringstream contents;
+            contents << file.rdbuf();
+            buffer = contents.str();
+        }
+        mappedData = buffer.data();
+        mappedSize = buffer.size();
+#else
+        int fd = ::open(filename.c_str(), O_RDONLY);
+        if (fd < 0) {
+            return;
+        }
+        struct stat st;
+        if (::fstat(fd, &st) == 0 && st.st_size > 0) {
+            void* mapping = ::mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+            if (mapping != MAP_FAILED) {
+                ::madvise(mapping, static_cast<size_t>(st.st_size), MADV_SEQUENTIAL);
+                mappedData = static_cast<const char*>(mapping);
+                mappedSize = static_cast<size_t>(st.st_size);
+            }
+        }
+        ::close(fd);
+#endif
+    }
+
+    ~MappedFile() {
+#ifndef _WIN32
+        if (mappedData) {
+            ::munmap(const_cast<char*>(mappedData), mappedSize);
+        }
+#endif
+    }
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    std::string_view view() const {
+        return std::string_view(mappedData, mappedSize);
+    }
+
+    // Calls fn(std::string_view) for every non-empty line, without copying.
+    template <typename Fn>
+    static void forEachLine(std::string_view content, Fn fn) {
+        size_t pos = 0;
+        while (pos < content.size()) {
+            size_t end = content.find('\n', pos);
+            if (end == std::string_view::npos) {
+                end = content.size();
+            }
+            std::string_view line = content.substr(pos, end - pos);
+            if (!line.empty() && line.back() == '\r') {
+                line.remove_suffix(1);
+            }
+            if (!line.empty()) {
+                fn(line);
+            }
+            pos = end + 1;
+        }
+    }
+};
+
+// Process-wide pool of interned strings, used for transaction descriptions.
+// Merchant names repeat heavily, so each distinct text is stored once and
+// transactions share it through an 8-byte Ref. Entries are reference
+// counted: the last Ref to a text frees it, so the pool only holds texts that
+// live transactions use, and an account's texts go when it is evicted.
+// Lookups are spread over independently locked shards by hash; each shard is
+// an open-addressing table of (hash, entry) slots, so a lookup hashes the
+// text once. Dropping a Ref takes the shard lock only when it is the last.
+class StringPool {
+private:
+    static const size_t SHARD_COUNT = 16;  // the top 4 bits of the mixed hash
+
+    // Followed by the characters.
+    struct Entry {
+        std::atomic<uint32_t> refs;
+        uint32_t length;
+        size_t hash;
+
+        const char* text() const { return reinterpret_cast<const char*>(this) + sizeof(Entry); }
+    };
+
+    struct Slot {
+        size_t hash;
+        Entry* entry;  // nullptr when free
+    };
+
+    struct Shard {
+        std::mutex mutex;
+        std::vector<Slot> slots;  // power-of-two size, at most half full
+        size_t count = 0;
+        size_t entryBytes = 0;
+    };
+
+    // Never destroyed: transactions may still be released while the
+    // process exits.
+    static std::array<Shard, SHARD_COUNT>& shards() {
+        static auto* instance = new std::array<Shard, SHARD_COUNT>();
+        return *instance;
+    }
+
+    static Shard& shardOf(size_t hash) {
+        return shards()[(static_cast<uint64_t>(hash) * 0x9E3779B97F4A7C15ULL) >> 60];
+    }
+
+    static size_t entrySize(size_t length) {
+        return sizeof(Entry) + length;
+    }
+
+    // Caller holds the shard's mutex.
+    static void grow(Shard& shard) {
+        std::vector<Slot> old(shard.slots.empty() ? 256 : shard.slots.size() * 2, Slot{0, nullptr});
+        old.swap(shard.slots);
+        size_t mask = shard.slots.size() - 1;
+        for (const Slot& slot : old) {
+            if (slot.entry) {
+                size_t i = slot.hash & mask;
+                while (shard.slots[i].entry) {
+                    i = (i + 1) & mask;
+                }
+                shard.slots[i] = slot;
+            }
+        }
+    }
+
+    static void retain(Entry* entry) {
+        if (entry) {
+            entry->refs.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+
+    // A count that reached zero never rises again (intern skips such an
+    // entry), so exactly one release removes and frees it.
+    static void release(Entry* entry) {
+        if (!entry || entry->refs.fetch_sub(1, std::memory_order_acq_rel) != 1) {
+            return;
+        }
+        Shard& shard = shardOf(entry->hash);
+        {
+            std::lock_guard<std::mutex> lock(shard.mutex);
+            size_t mask = shard.slots.size() - 1;
+            size_t i = entry->hash & mask;
+            while (shard.slots[i].entry != entry) {
+                i = (i + 1) & mask;
+            }
+            // Backward-shift deletion: pull later slots of the probe run into
+            // the hole unless that would move them before their home slot.
+            for (size_t j = (i + 1) & mask; shard.slots[j].entry; j = (j + 1) & mask) {
+                size_t home = shard.slots[j].hash & mask;
+                if (((j - home) & mask) >= ((j - i) & mask)) {
+                    shard.slots[i] = shard.slots[j];
+                    i = j;
+                }
+            }
+            shard.slots[i] = Slot{0, nullptr};
+            --shard.count;
+            shard.entryBytes -= entrySize(entry->length);
+        }
+        entry->~Entry();
+        ::operator delete(entry);
+    }
+
+public:
+    // Counted reference to an interned text. The empty text has no entry.
+    class Ref {
+    public:
+        Ref() = default;
+        Ref(const Ref& other) : entry(other.entry) { retain(entry); }
+        Ref(Ref&& other) noexcept : entry(other.entry) { other.entry = nullptr; }
+        ~Ref() { release(entry); }
+
+        Ref& operator=(Ref other) noexcept {
+            std::swap(entry, other.entry);
+            return *this;
+        }
+
+        std::string_view view() const {
+            return entry ? std::string_view(entry->text(), entry->length) : std::string_view();
+        }
+
+        // Equal for every Ref to the same text; usable as a hash key.
+        const void* key() const { return entry; }
+
+        // Bytes the text takes in the pool.
+        size_t footprint() const { return entry ? entrySize(entry->length) : 0; }
+
+    private:
+        friend class StringPool;
+        explicit Ref(Entry* interned) : entry(interned) {}
+        Entry* entry = nullptr;
+    };
+
+    static Ref intern(std::string_view text) {
+        if (text.empty()) {
+            return Ref();
+        }
+        if (text.size() > std::numeric_limits<uint32_t>::max()) {
+            throw std::runtime_error("String too long to intern");
+        }
+        size_t hash = std::hash<std::string_view>()(text);
+        Shard& shard = shardOf(hash);
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        if (2 * (shard.count + 1) > shard.slots.size()) {
+            grow(shard);
+        }
+        size_t mask = shard.slots.size() - 1;
+        size_t i = hash & mask;
+        for (; shard.slots[i].entry; i = (i + 1) & mask) {
+            Entry* entry = shard.slots[i].entry;
+            if (entry->hash != hash || std::string_view(entry->text(), entry->length) != text) {
+                continue;
+            }
+            uint32_t refs = entry->refs.load(std::memory_order_relaxed);
+            while (refs != 0 && !entry->refs.compare_exchange_weak(refs, refs + 1, std::memory_order_relaxed)) {
+            }
+            if (refs != 0) {
+                return Ref(entry);
+            }
+            // Being released; its releaser will remove it. Add a fresh copy.
+        }
+        void* memory = ::operator new(entrySize(text.size()));
+        Entry* entry = new (memory) Entry{{1}, static_cast<uint32_t>(text.size()), hash};
+        std::memcpy(reinterpret_cast<char*>(entry) + sizeof(Entry), text.data(), text.size());
+        shard.slots[i] = Slot{hash, entry};
+        ++shard.count;
+        shard.entryBytes += entrySize(text.size());
+        return Ref(entry);
+    }
+
+    // Distinct strings held.
+    static size_t size() {
+        size_t count = 0;
+        for (Shard& shard : shards()) {
+            std::lock_guard<std::mutex> lock(shard.mutex);
+            count += shard.count;
+        }
+        return count;
+    }
+
+    // Entries plus the slot tables.
+    static size_t memoryUsage() {
+        size_t bytes = 0;
+        for (Shard& shard : shards()) {
+            std::lock_guard<std::mutex> lock(shard.mutex);
+            bytes += shard.entryBytes + shard.slots.capacity() * sizeof(Slot);
+        }
+        return bytes;
+    }
+};
+
+class Transaction : public BaseEntity {
+private:
+    double amount;
+    SpendingCategory category;
+    StringPool::Ref description;
+    time_t transactionDate;
+
+public:
+    Transaction(double amt, SpendingCategory cat, std::string_view desc = "")
+        : BaseEntity(), amount(amt), category(cat), description(StringPool::intern(desc))
+        { transactionDate = std::time(nullptr); }
+
+    Transaction(EntityId transId, double amt, SpendingCategory cat, std::string_view desc,
+                time_t date, time_t created, time_t updated)
+        : BaseEntity(transId, created, updated), amount(amt), category(cat),
+          description(StringPool::intern(desc)), transactionDate(date) {}
+
+    std::string serialize() const {
+        std::string line;
+        appendSerialized(line);
+        return line;
+    }
+
+    // Appends the serialized form to `out`, so bulk writers can build one
+    // buffer without temporaries. Amounts are written in shortest round-trip
+    // form rather than with stream precision.
+    void appendSerialized(std::string& out) const {
+        char buffer[32];
+        auto appendInteger = [&out, &buffer](long long value) {
+            out.append(buffer, std::to_chars(buffer, buffer + sizeof(buffer), value).ptr);
+        };
+        out.append(buffer, std::to_chars(buffer, buffer + sizeof(buffer), id).ptr);
+        out += ',';
+        out.append(buffer, std::to_chars(buffer, buffer + sizeof(buffer), amount).ptr);
+        out += ',';
+        appendInteger(static_cast<int>(category));
+        out += ',';
+        out += getDescription();
+        out += ',';
+        appendInteger(transactionDate);
+        out += ',';
+        appendInteger(createdAt);
+        out += ',';
+        appendInteger(updatedAt);
+    }
+
+    static Transaction deserialize(const std::string& data) {
+        return deserialize(std::string_view(data));
+    }
+
+    // Parses one serialized line in place. The id, amount and category are read
+    // from the left and the three timestamps from the right, so the description
+    // is whatever lies between them, commas included.
+    static Transaction deserialize(std::string_view data) {
+        std::string_view fields[6];
+        std::string_view rest = data;
+        for (int i = 0; i < 3; ++i) {
+            size_t comma = rest.find(',');
+            if (comma == std::string_view::npos) {
+                throw std::runtime_error("Invalid transaction data format");
+            }
+            fields[i] = rest.substr(0, comma);
+            rest.remove_prefix(comma + 1);
+        }
+        for (int i = 5; i >= 3; --i) {
+            size_t comma = rest.rfind(',');
+            if (comma == std::string_view::npos) {
+                throw std::runtime_error("Invalid transaction data format");
+            }
+            fields[i] = rest.substr(comma + 1);
+            rest.remove_suffix(rest.size() - comma);
+        }
+
+        EntityId transId;
+        double amount;
+        int category;
+        long long transactionDate, createdAt, updatedAt;
+        if (!parseNumber(fields[0], transId) || !parseNumber(fields[1], amount) || !parseNumber(fields[2], category) ||
+            !parseNumber(fields[3], transactionDate) || !parseNumber(fields[4], createdAt) ||
+            !parseNumber(fields[5], updatedAt) || category < 0 ||
+            category > static_cast<int>(SpendingCategory::MISCELLANEOUS)) {
+            throw std::runtime_error("Invalid transaction data format");
+        }
+
+        return Transaction(transId, amount, static_cast<SpendingCategory>(category), rest,
+                           static_cast<time_t>(transactionDate), static_cast<time_t>(createdAt),
+                           static_cast<time_t>(updatedAt));
+    }
+
+    // Edits the transaction in place; the id, date and createdAt are kept.
+    void update(double newAmount, SpendingCategory newCategory, std::string_view newDescription) {
+        amount = newAmount;
+        category = newCategory;
+        description = StringPool::intern(newDescription);
+        updateTimestamp();
+    }
+
+    double getAmount() const { return amount; }
+    SpendingCategory getCategory() const { return category; }
+    // Valid while this transaction, or another holder of the text, lives.
+    std::string_view getDescription() const { return description.view(); }
+    const StringPool::Ref& getDescriptionRef() const { return description; }
+    time_t getDate() const { return transactionDate; }
+};
+
+// Spending reductions over the TransactionColumns arrays. Category totals
+// are a histogram: each row adds its amount to its category's slot, spread
+// over four tables of 256 slots so that consecutive rows of one category do
+// not wait on each other's adds and no category byte needs a range check.
+// Rows outside the range of sumByCategoryInRange go to slot 255 without a
+// branch. Masked SSE2 and AVX2 reductions, which pay a compare and an add
+// per category for every row, measured slower than this on 10M rows, so
+// only overBudgetMask has vector versions, chosen once at startup.
+class SpendingKernels {
+public:
+    static const int LANES = 8;
+    static_assert(static_cast<int>(SpendingCategory::MISCELLANEOUS) + 1 == LANES,
+                  "one kernel lane per SpendingCategory");
+
+    enum class Level {
+        SCALAR,
+        SSE2,
+        AVX2
+    };
+
+    static Level getLevel() {
+        return dispatch().level;
+    }
+
+    static const char* getLevelName() {
+        switch (getLevel()) {
+            case Level::AVX2: return "AVX2";
+            case Level::SSE2: return "SSE2";
+            default: return "scalar";
+        }
+    }
+
+    // totals[c] = sum of amounts[i] where categories[i] == c.
+    static void sumByCategory(const double* amounts, const uint8_t* categories, size_t n, double* totals) {
+        Histogram histogram{};
+        size_t i = 0;
+        for (; i + 4 <= n; i += 4) {
+            histogram[0][categories[i]] += amounts[i];
+            histogram[1][categories[i + 1]] += amounts[i + 1];
+            histogram[2][categories[i + 2]] += amounts[i + 2];
+            histogram[3][categories[i + 3]] += amounts[i + 3];
+        }
+        for (; i < n; ++i) {
+            histogram[0][categories[i]] += amounts[i];
+        }
+        fold(histogram, totals);
+    }
+
+    // As sumByCategory, restricted to rows with start <= dates[i] < end.
+    static void sumByCategoryInRange(const double* amounts, const uint8_t* categories, const int64_t* dates,
+                                     size_t n, int64_t start, int64_t end, double* totals) {
+        Histogram histogram{};
+        auto slot = [categories, dates, start, end](size_t row) {
+            unsigned outside = !((dates[row] >= start) & (dates[row] < end));
+            return categories[row] | (0xFFu & (0u - outside));
+        };
+        size_t i = 0;
+        for (; i + 4 <= n; i += 4) {
+            histogram[0][slot(i)] += amounts[i];
+            histogram[1][slot(i + 1)] += amounts[i + 1];
+            histogram[2][slot(i + 2)] += amounts[i + 2];
+            histogram[3][slot(i + 3)] += amounts[i + 3];
+        }
+        for (; i < n; ++i) {
+            histogram[0][slot(i)] += amounts[i];
+        }
+        fold(histogram, totals);
+    }
+
+    // Bit c is set when totals[c] > limits[c]. Use +infinity for no limit.
+    static uint8_t overBudgetMask(const double* totals, const double* limits) {
+        return dispatch().overBudgetMask(totals, limits);
+    }
+
+private:
+    using Histogram = std::array<std::array<double, 256>, 4>;
+    using MaskFn = uint8_t (*)(const double*, const double*);
+
+    struct Dispatch {
+        Level level;
+        MaskFn overBudgetMask;
+    };
+
+    static void fold(const Histogram& histogram, double* totals) {
+        for (int c = 0; c < LANES; ++c) {
+            totals[c] = (histogram[0][c] + histogram[1][c]) + (histogram[2][c] + histogram[3][c]);
+        }
+    }
+
+    static const Dispatch& dispatch() {
+        static const Dispatch selected = select();
+        return selected;
+    }
+
+    static Dispatch select() {
+#ifdef PFM_X86_64
+        if (cpuHasAvx2()) {
+            return Dispatch{Level::AVX2, maskAvx2};
+        }
+        return Dispatch{Level::SSE2, maskSse2};
+#else
+        return Dispatch{Level::SCALAR, maskScalar};
+#endif
+    }
+
+    static uint8_t maskScalar(const double* totals, const double* limits) {
+        uint8_t mask = 0;
+        for (int c = 0; c < LANES; ++c) {
+            mask |= static_cast<uint8_t>(totals[c] > limits[c]) << c;
+        }
+        return mask;
+    }
+
+#ifdef PFM_X86_64
+    static bool cpuHasAvx2() {
+#ifdef _MSC_VER
+        int regs[4];
+        __cpuid(regs, 1);
+        bool osxsave = (regs[2] & (1 << 27)) != 0;
+        bool avx = (regs[2] & (1 << 28)) != 0;
+        if (!osxsave || !avx || (_xgetbv(0) & 0x6) != 0x6) {
+            return false;
+        }
+        __cpuidex(regs, 7, 0);
+        return (regs[1] & (1 << 5)) != 0;
+#else
+        __builtin_cpu_init();
+        return __builtin_cpu_supports("avx2");
+#endif
+    }
+
+    static uint8_t maskSse2(const double* totals, const double* limits) {
+        int mask = 0;
+        for (int c = 0; c < LANES; c += 2) {
+            __m128d over = _mm_cmpgt_pd(_mm_loadu_pd(totals + c), _mm_loadu_pd(limits + c));
+            mask |= _mm_movemask_pd(over) << c;
+        }
+        return static_cast<uint8_t>(mask);
+    }
+
+    PFM_TARGET_AVX2
+    static uint8_t maskAvx2(const double* totals, const double* limits) {
+        __m256d low = _mm256_cmp_pd(_mm256_loadu_pd(totals), _mm256_loadu_pd(limits), _CMP_GT_OQ);
+        __m256d high = _mm256_cmp_pd(_mm256_loadu_pd(totals + 4), _mm256_loadu_pd(limits + 4), _CMP_GT_OQ);
+        return static_cast<uint8_t>(_mm256_movemask_pd(low) | (_mm256_movemask_pd(high) << 4));
+    }
+#endif
+};
+
+// Copy-on-write handle to a value an owner shares with its snapshots. Copying
+// the handle marks the value shared for good, and write() copies a shared
+// value before handing it out. A use count cannot stand in for the mark: a
+// reader dropping the last other reference is not ordered before the owner's
+// next write. Only the owner writes, so it alone sees an unshared value.
+template <typename T>
+class SharedValue {
+private:
+    struct Node {
+        T value;
+        mutable std::atomic<bool> shared{false};
+
+        template <typename... Args>
+        explicit Node(Args&&... args) : value(std::forward<Args>(args)...) {}
+    };
+    std::shared_ptr<Node> node;
+
+    void markShared() const {
+        if (node) {
+            node->shared.store(true, std::memory_order_relaxed);
+        }
+    }
+
+public:
+    template <typename... Args>
+    static SharedValue make(Args&&... args) {
+        SharedValue handle;
+        handle.node = std::make_shared<Node>(std::forward<Args>(args)...);
+        return handle;
+    }
+
+    SharedValue() = default;
+    SharedValue(const SharedValue& other) : node(other.node) { markShared(); }
+    SharedValue(SharedValue&&) noexcept = default;
+
+    SharedValue& operator=(const SharedValue& other) {
+        node = other.node;
+        markShared();
+        return *this;
+    }
+
+    SharedValue& operator=(SharedValue&&) noexcept = default;
+
+    const T& operator*() const { return node->value; }
+    const T* operator->() const { return &node->value; }
+
+    // Read-only pointer for a snapshot.
+    std::shared_ptr<const T> share() const {
+        markShared();
+        return std::shared_ptr<const T>(node, &node->value);
+    }
+
+    T& write() {
+        if (node->shared.load(std::memory_order_relaxed)) {
+            node = std::make_shared<Node>(node->value);
+        }
+        return node->value;
+    }
+};
+
+// A vector stored as fixed-size chunks, each held by a SharedValue. A copy
+// shares every chunk, and a write to a chunk that was ever shared copies that
+// chunk first. Account keeps its bulk state this way, so a snapshot costs a
+// pointer per chunk and a later write copies only the chunks it touches.
+// Chunk c holds elements [c * CHUNK, c * CHUNK + chunkSize(c)).
+template <typename T>
+class SharedChunks {
+public:
+    static const size_t CHUNK = 1024;
+
+private:
+    using Chunk = std::vector<T>;
+    std::vector<SharedValue<Chunk>> chunks;
+    size_t count = 0;
+
+    Chunk& writable(size_t index) { return chunks[index].write(); }
+
+public:
+    class const_iterator {
+    public:
+        const_iterator(const SharedChunks* chunks, size_t position) : owner(chunks), index(position) {}
+        const T& operator*() const { return (*owner)[index]; }
+        const T* operator->() const { return &(*owner)[index]; }
+        const_iterator& operator++() {
+            ++index;
+            return *this;
+        }
+        bool operator==(const const_iterator& other) const { return index == other.index; }
+        bool operator!=(const const_iterator& other) const { return index != other.index; }
+
+    private:
+        const SharedChunks* owner;
+        size_t index;
+    };
+
+    size_t size() const { return count; }
+    bool empty() const { return count == 0; }
+    const_iterator begin() const { return const_iterator(this, 0); }
+    const_iterator end() const { return const_iterator(this, count); }
+
+    const T& operator[](size_t index) const { return (*chunks[index / CHUNK])[index % CHUNK]; }
+    const T& back() const { return chunks.back()->back(); }
+
+    // Writable element, unshared first if need be.
+    T& write(size_t index) { return writable(index / CHUNK)[index % CHUNK]; }
+
+    template <typename... Args>
+    void emplace_back(Args&&... args) {
+        if (count % CHUNK == 0) {
+            chunks.push_back(SharedValue<Chunk>::make());
+            chunks.back().write().reserve(CHUNK);
+        }
+        writable(chunks.size() - 1).emplace_back(std::forward<Args>(args)...);
+        ++count;
+    }
+
+    void push_back(T value) { emplace_back(std::move(value)); }
+
+    void pop_back() {
+        writable(chunks.size() - 1).pop_back();
+        if (--count % CHUNK == 0) {
+            chunks.pop_back();
+        }
+    }
+
+    void clear() {
+        chunks.clear();
+        count = 0;
+    }
+
+    void reserve(size_t elements) { chunks.reserve((elements + CHUNK - 1) / CHUNK); }
+
+    size_t chunkCount() const { return chunks.size(); }
+    const T* chunkData(size_t index) const { return chunks[index]->data(); }
+    size_t chunkSize(size_t index) const { return chunks[index]->size(); }
+
+    // Counts every chunk at its reserved size, without visiting them.
+    size_t memoryUsage() const {
+        return chunks.capacity() * sizeof(SharedValue<Chunk>) + chunks.size() * (sizeof(Chunk) + CHUNK * sizeof(T));
+    }
+};
+
+// Structure-of-arrays copy of the fields aggregations scan: one array each
+// for amounts, categories, dates and ids, indexed by the same slot as
+// Account::transactions. Summing a column touches only that column instead
+// of striding over whole Transaction objects. The arrays are SharedChunks
+// with the same chunk boundaries, so they are scanned a Block at a time.
+class TransactionColumns {
+public:
+    static const int CATEGORY_COUNT = static_cast<int>(SpendingCategory::MISCELLANEOUS) + 1;
+    using CategoryTotals = std::array<double, CATEGORY_COUNT>;
+
+    // One chunk of every column.
+    struct Block {
+        const double* amounts;
+        const uint8_t* categories;
+        const int64_t* dates;
+        const EntityId* ids;
+        size_t rows;
+    };
+
+private:
+    SharedChunks<double> amounts;
+    SharedChunks<uint8_t> categories;
+    SharedChunks<int64_t> dates;
+    SharedChunks<EntityId> ids;
+
+public:
+    size_t size() const { return amounts.size(); }
+    size_t blockCount() const { return amounts.chunkCount(); }
+
+    Block block(size_t index) const {
+        return Block{amounts.chunkData(index), categories.chunkData(index), dates.chunkData(index),
+                     ids.chunkData(index), amounts.chunkSize(index)};
+    }
+
+    void clear() {
+        amounts.clear();
+        categories.clear();
+        dates.clear();
+        ids.clear();
+    }
+
+    void reserve(size_t rows) {
+        amounts.reserve(rows);
+        categories.reserve(rows);
+        dates.reserve(rows);
+        ids.reserve(rows);
+    }
+
+    void push(const Transaction& trans) {
+        amounts.push_back(trans.getAmount());
+        categories.push_back(static_cast<uint8_t>(trans.getCategory()));
+        dates.push_back(static_cast<int64_t>(trans.getDate()));
+        ids.push_back(trans.getId());
+    }
+
+    void set(size_t slot, const Transaction& trans) {
+        amounts.write(slot) = trans.getAmount();
+        categories.write(slot) = static_cast<uint8_t>(trans.getCategory());
+        dates.write(slot) = static_cast<int64_t>(trans.getDate());
+        ids.write(slot) = trans.getId();
+    }
+
+    // Mirrors Account's swap-and-pop delete.
+    void removeAt(size_t slot) {
+        amounts.write(slot) = amounts.back();
+        categories.write(slot) = categories.back();
+        dates.write(slot) = dates.back();
+        ids.write(slot) = ids.back();
+        amounts.pop_back();
+        categories.pop_back();
+        dates.pop_back();
+        ids.pop_back();
+    }
+
+    size_t memoryUsage() const {
+        return amounts.memoryUsage() + categories.memoryUsage() + dates.memoryUsage() + ids.memoryUsage();
+    }
+
+    // Per-category totals over all rows; present[c] tells whether category c
+    // occurs at all.
+    void sumByCategory(CategoryTotals& totals, std::array<bool, CATEGORY_COUNT>& present) const {
+        totals.fill(0.0);
+        present.fill(false);
+        int seen = 0;
+        for (size_t b = 0; b < blockCount(); ++b) {
+            Block rows = block(b);
+            CategoryTotals partial;
+            SpendingKernels::sumByCategory(rows.amounts, rows.categories, rows.rows, partial.data());
+            for (int c = 0; c < CATEGORY_COUNT; ++c) {
+                totals[c] += partial[c];
+            }
+            for (size_t i = 0; i < rows.rows && seen < CATEGORY_COUNT; ++i) {
+                uint8_t category = rows.categories[i];
+                if (category < CATEGORY_COUNT && !present[category]) {
+                    present[category] = true;
+                    ++seen;
+                }
+            }
+        }
+    }
+
+    // Per-category totals over rows dated in [start, end).
+    CategoryTotals sumByCategoryInRange(int64_t start, int64_t end) const {
+        CategoryTotals totals{};
+        for (size_t b = 0; b < blockCount(); ++b) {
+            Block rows = block(b);
+            CategoryTotals partial;
+            SpendingKernels::sumByCategoryInRange(rows.amounts, rows.categories, rows.dates, rows.rows, start, end,
+                                                  partial.data());
+            for (int c = 0; c < CATEGORY_COUNT; ++c) {
+                totals[c] += partial[c];
+            }
+        }
+        return totals;
+    }
+};
+
+// Transactions ordered by (transactionDate, id), holding the fields range
+// queries read, in a list of sorted chunks. The chunk holding a key is found
+// by binary search on the chunks' last keys, so an insert, update or erase
+// costs a search plus a shift within one chunk rather than the whole index.
+// A chunk past 2 * CHUNK entries splits in two, and one that fits into CHUNK
+// entries together with its right neighbour merges with it. Appending in
+// date order, the usual case, only pushes onto the last chunk. A date range
+// is answered in place as a Range spanning consecutive chunks. As in
+// SharedChunks, copies share chunks and a write copies a shared chunk first.
+class TransactionDateIndex {
+public:
+    using CategoryTotals = TransactionColumns::CategoryTotals;
+    static const int CATEGORY_COUNT = TransactionColumns::CATEGORY_COUNT;
+
+    struct Entry {
+        int64_t date;
+        EntityId id;
+        double amount;
+        uint8_t category;
+
+        bool operator<(const Entry& other) const {
+            return date != other.date ? date < other.date : id < other.id;
+        }
+    };
+
+    using Chunk = std::vector<Entry>;
+    using ChunkPtr = SharedValue<Chunk>;
+    struct Range;
+
+    // Position of an entry as its chunk and offset. The end of a chunk is
+    // always written as the start of the next, so equal positions compare
+    // equal.
+    class Iterator {
+    public:
+        Iterator() = default;
+        Iterator(const ChunkPtr* at, size_t index) : chunk(at), offset(index) {}
+
+        const Entry& operator*() const { return (**chunk)[offset]; }
+        const Entry* operator->() const { return &(**chunk)[offset]; }
+
+        Iterator& operator++() {
+            if (++offset == (*chunk)->size()) {
+                ++chunk;
+                offset = 0;
+            }
+            return *this;
+        }
+
+        bool operator==(const Iterator& other) const { return chunk == other.chunk && offset == other.offset; }
+        bool operator!=(const Iterator& other) const { return !(*this == other); }
+
+    private:
+        friend struct Range;
+        const ChunkPtr* chunk = nullptr;
+        size_t offset = 0;
+    };
+
+    // Half-open run of entries in date order. Valid until the index changes;
+    // a snapshot's index never does.
+    struct Range {
+        Iterator first;
+        Iterator last;
+
+        Iterator begin() const { return first; }
+        Iterator end() const { return last; }
+        bool empty() const { return first == last; }
+
+        // Calls fn(begin, end) on each contiguous part of the range.
+        template <typename F>
+        void forEachRun(F&& fn) const {
+            const ChunkPtr* chunk = first.chunk;
+            size_t offset = first.offset;
+            for (; chunk != last.chunk; ++chunk, offset = 0) {
+                fn((*chunk)->data() + offset, (*chunk)->data() + (*chunk)->size());
+            }
+            if (offset < last.offset) {
+                fn((*chunk)->data() + offset, (*chunk)->data() + last.offset);
+            }
+        }
+
+        size_t size() const {
+            size_t count = 0;
+            forEachRun([&count](const Entry* begin, const Entry* end) { count += static_cast<size_t>(end - begin); });
+            return count;
+        }
+
+        CategoryTotals totalsByCategory() const {
+            CategoryTotals totals{};
+            forEachRun([&totals](const Entry* begin, const Entry* end) {
+                for (const Entry* entry = begin; entry != end; ++entry) {
+                    if (entry->category < CATEGORY_COUNT) {
+                        totals[entry->category] += entry->amount;
+                    }
+                }
+            });
+            return totals;
+        }
+
+        double total(SpendingCategory category) const {
+            double total = 0.0;
+            uint8_t wanted = static_cast<uint8_t>(category);
+            forEachRun([&total, wanted](const Entry* begin, const Entry* end) {
+                for (const Entry* entry = begin; entry != end; ++entry) {
+                    if (entry->category == wanted) {
+                        total += entry->amount;
+                    }
+                }
+            });
+            return total;
+        }
+    };
+
+private:
+    static const size_t CHUNK = 512;
+
+    std::vector<ChunkPtr> chunks;  // never holds an empty chunk
+    size_t count = 0;
+
+    Chunk& writable(size_t index) { return chunks[index].write(); }
+
+    static Entry makeEntry(const Transaction& trans) {
+        return Entry{static_cast<int64_t>(trans.getDate()), trans.getId(), trans.getAmount(),
+                     static_cast<uint8_t>(trans.getCategory())};
+    }
+
+    // The chunk that holds, or would hold, `key`. There must be one.
+    size_t chunkFor(const Entry& key) const {
+        auto it = std::lower_bound(chunks.begin(), chunks.end(), key,
+                                   [](const ChunkPtr& chunk, const Entry& wanted) { return chunk->back() < wanted; });
+        return it == chunks.end() ? chunks.size() - 1 : static_cast<size_t>(it - chunks.begin());
+    }
+
+    std::pair<size_t, Chunk::iterator> find(const Transaction& trans) {
+        Entry key = makeEntry(trans);
+        if (!chunks.empty()) {
+            size_t index = chunkFor(key);
+            const Chunk& chunk = *chunks[index];
+            auto it = std::lower_bound(chunk.begin(), chunk.end(), key);
+            if (it != chunk.end() && it->id == key.id) {
+                auto offset = it - chunk.begin();
+                return {index, writable(index).begin() + offset};
+            }
+        }
+        throw std::runtime_error("Transaction missing from date index");
+    }
+
+    // First entry dated at or after `date`.
+    Iterator lowerBound(int64_t date) const {
+        auto chunk = std::lower_bound(chunks.begin(), chunks.end(), date,
+                                      [](const ChunkPtr& c, int64_t wanted) { return c->back().date < wanted; });
+        if (chunk == chunks.end()) {
+            return Iterator(chunks.data() + chunks.size(), 0);
+        }
+        auto byDate = [](const Entry& entry, int64_t wanted) { return entry.date < wanted; };
+        const Chunk& entries = **chunk;
+        return Iterator(&*chunk, static_cast<size_t>(std::lower_bound(entries.begin(), entries.end(), date, byDate) -
+                                                     entries.begin()));
+    }
+
+public:
+    size_t size() const { return count; }
+
+    // Rebuilds from the columns; already-ordered data is only checked.
+    void build(const TransactionColumns& columns) {
+        Chunk entries;
+        entries.reserve(columns.size());
+        for (size_t b = 0; b < columns.blockCount(); ++b) {
+            TransactionColumns::Block rows = columns.block(b);
+            for (size_t i = 0; i < rows.rows; ++i) {
+                entries.push_back(Entry{rows.dates[i], rows.ids[i], rows.amounts[i], rows.categories[i]});
+            }
+        }
+        if (!std::is_sorted(entries.begin(), entries.end())) {
+            std::sort(entries.begin(), entries.end());
+        }
+        chunks.clear();
+        for (size_t begin = 0; begin < entries.size(); begin += CHUNK) {
+            chunks.push_back(ChunkPtr::make(entries.begin() + begin,
+                                            entries.begin() + std::min(begin + CHUNK, entries.size())));
+        }
+        count = entries.size();
+    }
+
+    void insert(const Transaction& trans) {
+        Entry entry = makeEntry(trans);
+        ++count;
+        if (chunks.empty()) {
+            chunks.push_back(ChunkPtr::make(1, entry));
+            return;
+        }
+        size_t index = chunkFor(entry);
+        Chunk& chunk = writable(index);
+        chunk.insert(std::upper_bound(chunk.begin(), chunk.end(), entry), entry);
+        if (chunk.size() > 2 * CHUNK) {
+            auto upper = ChunkPtr::make(chunk.begin() + CHUNK, chunk.end());
+            chunk.resize(CHUNK);
+            chunks.insert(chunks.begin() + index + 1, std::move(upper));
+        }
+    }
+
+    // Amount and category may change; the date and id may not.
+    void update(const Transaction& trans) {
+        auto it = find(trans).second;
+        it->amount = trans.getAmount();
+        it->category = static_cast<uint8_t>(trans.getCategory());
+    }
+
+    void erase(const Transaction& trans) {
+        auto [index, it] = find(trans);
+        Chunk& chunk = writable(index);
+        chunk.erase(it);
+        --count;
+        if (index + 1 < chunks.size() && chunk.size() + chunks[index + 1]->size() <= CHUNK) {
+            const Chunk& next = *chunks[index + 1];
+            chunk.insert(chunk.end(), next.begin(), next.end());
+            chunks.erase(chunks.begin() + index + 1);
+        } else if (chunk.empty()) {
+            chunks.erase(chunks.begin() + index);
+        }
+    }
+
+    // Entries dated in [start, end).
+    Range between(time_t start, time_t end) const {
+        Iterator first = lowerBound(start);
+        return Range{first, end <= start ? first : lowerBound(end)};
+    }
+
+    // Entries plus chunk overhead; slack within chunks is not counted.
+    size_t memoryUsage() const {
+        return chunks.capacity() * sizeof(ChunkPtr) + chunks.size() * sizeof(Chunk) + count * sizeof(Entry);
+    }
+};
+
+// Money added to an account. Deposits are kept as entries, like
+// transactions, so the balance can be reconstructed at any past date.
+class Deposit {
+public:
+    EntityId id;
+    double amount;
+    time_t date;
+
+    Deposit(EntityId depositId, double amt, time_t depositDate) : id(depositId), amount(amt), date(depositDate) {}
+
+    // "id,amount,date".
+    void appendSerialized(std::string& out) const {
+        char buffer[32];
+        out.append(buffer, std::to_chars(buffer, buffer + sizeof(buffer), id).ptr);
+        out += ',';
+        out.append(buffer, std::to_chars(buffer, buffer + sizeof(buffer), amount).ptr);
+        out += ',';
+        out.append(buffer, std::to_chars(buffer, buffer + sizeof(buffer), static_cast<long long>(date)).ptr);
+    }
+
+    static Deposit deserialize(std::string_view data) {
+        size_t first = data.find(',');
+        size_t second = first == std::string_view::npos ? first : data.find(',', first + 1);
+        EntityId depositId;
+        double amount;
+        long long date;
+        if (second == std::string_view::npos || !parseNumber(data.substr(0, first), depositId) ||
+            !parseNumber(data.substr(first + 1, second - first - 1), amount) ||
+            !parseNumber(data.substr(second + 1), date)) {
+            throw std::runtime_error("Invalid deposit data format");
+        }
+        return Deposit(depositId, amount, static_cast<time_t>(date));
+    }
+};
+
+// Net balance change per local calendar day in a Fenwick tree, so the flow up
+// to a day or between two days takes O(log days) and an entry on any date,
+// backdated or not, is one point update. The tree covers a window of days
+// that doubles, with one O(days) rebuild, when an entry falls outside it.
+class BalanceHistory {
+private:
+    int firstDay = 0;
+    std::vector<double> daily;  // flow of day firstDay + i
+    std::vector<double> tree;   // 1-based Fenwick sums over daily
+    double total = 0.0;
+
+    void rebuildTree() {
+        tree.assign(daily.size() + 1, 0.0);
+        for (size_t i = 1; i < tree.size(); ++i) {
+            tree[i] += daily[i - 1];
+            size_t parent = i + (i & (0 - i));
+            if (parent < tree.size()) {
+                tree[parent] += tree[i];
+            }
+        }
+    }
+
+    void cover(int day) {
+        if (daily.empty()) {
+            firstDay = day;
+            daily.assign(64, 0.0);
+            tree.assign(65, 0.0);
+            return;
+        }
+        int lastDay = firstDay + static_cast<int>(daily.size()) - 1;
+        if (day >= firstDay && day <= lastDay) {
+            return;
+        }
+        int newFirst = std::min(day, firstDay);
+        int span = std::max(lastDay, day) - newFirst + 1;
+        size_t capacity = daily.size();
+        while (capacity < static_cast<size_t>(span)) {
+            capacity *= 2;
+        }
+        // Growing downwards leaves the spare room below the earliest day.
+        if (day < firstDay) {
+            newFirst = lastDay - static_cast<int>(capacity) + 1;
+        }
+        std::vector<double> grown(capacity, 0.0);
+        std::copy(daily.begin(), daily.end(), grown.begin() + (firstDay - newFirst));
+        daily.swap(grown);
+        firstDay = newFirst;
+        rebuildTree();
+    }
+
+public:
+    void clear() {
+        daily.clear();
+        tree.clear();
+        total = 0.0;
+    }
+
+    void add(time_t date, double amount) {
+        int day = DateUtils::dayNumber(date);
+        cover(day);
+        size_t index = static_cast<size_t>(day - firstDay);
+        daily[index] += amount;
+        for (size_t i = index + 1; i < tree.size(); i += i & (0 - i)) {
+            tree[i] += amount;
+        }
+        total += amount;
+    }
+
+    double totalFlow() const { return total; }
+
+    // Sum of all entries dated on or before `day`.
+    double flowThrough(int day) const {
+        if (daily.empty() || day < firstDay) {
+            return 0.0;
+        }
+        size_t i = std::min(static_cast<size_t>(day - firstDay) + 1, daily.size());
+        double sum = 0.0;
+        for (; i > 0; i -= i & (0 - i)) {
+            sum += tree[i];
+        }
+        return sum;
+    }
+
+    size_t memoryUsage() const {
+        return (daily.capacity() + tree.capacity()) * sizeof(double);
+    }
+};
+
+// Inverted index from description words to the transactions containing them.
+// A word is a run of ASCII letters and digits, compared case-insensitively.
+// Terms are kept sorted, so the terms matching a prefix are one contiguous
+// run. Each posting list is sorted by id and carries the date and category,
+// so filters are checked without looking up the transactions.
+//
+// A query is a list of words that must all match; a word ending in '*'
+// matches any term starting with it. One word drives the match, walking its
+// posting lists in id order, and the others are probed by binary search. The
+// driver is the word with the fewest postings times probes per posting.
+//
+// Postings that arrive out of id order (bulk loads, imports) are appended and
+// the list is sorted once by normalize(), which every Account mutation ends
+// with; queries and removals need a normalized index.
+//
+// Copies of the index share the term map and the posting lists, held as
+// SharedValues. A write copies the map, and then each list it changes, once
+// they were shared, so a snapshot's copy is O(1) and the next write pays for
+// the terms map plus the lists it touches.
+class DescriptionIndex {
+public:
+    // 16 bytes: the signed date in seconds shares a word with the category,
+    // which takes the low 8 bits.
+    struct Posting {
+        EntityId id;
+        int64_t stamp;
+
+        Posting(EntityId postingId, int64_t date, uint8_t category)
+            : id(postingId),
+              stamp(static_cast<int64_t>(static_cast<uint64_t>(std::clamp(date, MIN_DATE, MAX_DATE)) << 8) |
+                    category) {}
+
+        int64_t date() const { return stamp >> 8; }
+        uint8_t category() const { return static_cast<uint8_t>(stamp & 0xFF); }
+    };
+
+    static constexpr int64_t MAX_DATE = std::numeric_limits<int64_t>::max() >> 8;
+    static constexpr int64_t MIN_DATE = std::numeric_limits<int64_t>::min() >> 8;
+
+    struct Filter {
+        int category = -1;  // any category when negative
+        int64_t start = std::numeric_limits<int64_t>::min();
+        int64_t end = std::numeric_limits<int64_t>::max();  // exclusive
+
+        bool matches(const Posting& posting) const {
+            int64_t date = posting.date();
+            return (category < 0 || posting.category() == category) & (date >= start) & (date < end);
+        }
+    };
+
+private:
+    using PostingList = std::vector<Posting>;
+    using Terms = std::map<std::string, SharedValue<PostingList>, std::less<>>;
+    SharedValue<Terms> terms = SharedValue<Terms>::make();
+    // Lists with postings appended out of order, mapped to the length of
+    // their sorted prefix. Only set within a mutation, once the list has
+    // been made writable.
+    std::unordered_map<PostingList*, size_t> unsorted;
+    size_t postingCount = 0;
+    size_t postingBytes = 0;  // capacity of all posting lists
+    size_t termBytes = 0;     // map nodes and heap-allocated keys
+
+    static size_t termFootprint(const std::string& term) {
+        static const size_t inlineCapacity = std::string().capacity();
+        // A red-black tree node: three links and a colour ahead of the value,
+        // then the list and its SharedValue node.
+        return 4 * sizeof(void*) + sizeof(Terms::value_type) + sizeof(PostingList) + 2 * sizeof(int) +
+               sizeof(void*) + (term.capacity() > inlineCapacity ? term.capacity() + 1 : 0);
+    }
+
+    Terms& writableTerms() { return terms.write(); }
+
+    PostingList& writable(SharedValue<PostingList>& list) {
+        size_t capacity = list->capacity();
+        PostingList& owned = list.write();
+        postingBytes += (owned.capacity() - capacity) * sizeof(Posting);
+        return owned;
+    }
+
+    // Calls f once per word, lowercased into a reused buffer.
+    template <typename F>
+    static void forEachWord(std::string_view text, F&& f) {
+        std::string word;
+        for (size_t i = 0; i <= text.size(); ++i) {
+            char c = i < text.size() ? text[i] : ' ';
+            if (c >= 'A' && c <= 'Z') {
+                word += static_cast<char>(c - 'A' + 'a');
+            } else if ((c >= 'a' && c <= 'z') || (c >= '0' && c <= '9')) {
+                word += c;
+            } else if (!word.empty()) {
+                f(word);
+                word.clear();
+            }
+        }
+    }
+
+    static bool contains(const PostingList& list, EntityId id) {
+        auto it = std::lower_bound(list.begin(), list.end(), id,
+                                   [](const Posting& posting, EntityId value) { return posting.id < value; });
+        return it != list.end() && it->id == id;
+    }
+
+    // The posting lists of one query word: a single term, or every term
+    // with the prefix.
+    struct Clause {
+        std::vector<const PostingList*> lists;
+        size_t postings = 0;
+
+        bool contains(EntityId id) const {
+            for (const PostingList* list : lists) {
+                if (DescriptionIndex::contains(*list, id)) {
+                    return true;
+                }
+            }
+            return false;
+        }
+    };
+
+    Clause findClause(std::string_view word, bool prefix) const {
+        Clause clause;
+        if (!prefix) {
+            auto it = terms->find(word);
+            if (it != terms->end()) {
+                clause.lists.push_back(&*it->second);
+                clause.postings = it->second->size();
+            }
+            return clause;
+        }
+        for (auto it = terms->lower_bound(word);
+             it != terms->end() && std::string_view(it->first).substr(0, word.size()) == word; ++it) {
+            clause.lists.push_back(&*it->second);
+            clause.postings += it->second->size();
+        }
+        return clause;
+    }
+
+public:
+    void clear() {
+        terms = SharedValue<Terms>::make();
+        unsorted.clear();
+        postingCount = 0;
+        postingBytes = 0;
+        termBytes = 0;
+    }
+
+    void add(const Transaction& trans) {
+        Posting posting(trans.getId(), trans.getDate(), static_cast<uint8_t>(trans.getCategory()));
+        Terms& map = writableTerms();
+        forEachWord(trans.getDescription(), [this, &map, &posting](const std::string& word) {
+            auto it = map.find(word);
+            if (it == map.end()) {
+                it = map.emplace(word, SharedValue<PostingList>::make()).first;
+                termBytes += termFootprint(it->first);
+            }
+            const PostingList& current = *it->second;
+            if (!current.empty() && current.back().id == posting.id) {
+                return;  // word repeated in the same description
+            }
+            PostingList& list = writable(it->second);
+            if (!list.empty() && posting.id < list.back().id) {
+                unsorted.try_emplace(&list, list.size());
+            }
+            size_t capacity = list.capacity();
+            list.push_back(posting);
+            ++postingCount;
+            postingBytes += (list.capacity() - capacity) * sizeof(Posting);
+        });
+    }
+
+    // Sorts the tails appended out of order into their lists. A single
+    // out-of-order posting costs one merge, like a sorted insert.
+    void normalize() {
+        for (auto& [list, sortedCount] : unsorted) {
+            auto middle = list->begin() + sortedCount;
+            auto byId = [](const Posting& a, const Posting& b) { return a.id < b.id; };
+            std::sort(middle, list->end(), byId);
+            std::inplace_merge(list->begin(), middle, list->end(), byId);
+            auto last = std::unique(list->begin(), list->end(),
+                                    [](const Posting& a, const Posting& b) { return a.id == b.id; });
+            postingCount -= static_cast<size_t>(list->end() - last);
+            list->erase(last, list->end());
+        }
+        unsorted.clear();
+    }
+
+    void remove(const Transaction& trans) {
+        normalize();
+        EntityId id = trans.getId();
+        Terms& map = writableTerms();
+        forEachWord(trans.getDescription(), [this, &map, id](const std::string& word) {
+            auto it = map.find(word);
+            if (it == map.end()) {
+                return;
+            }
+            const PostingList& current = *it->second;
+            auto at = std::lower_bound(current.begin(), current.end(), id,
+                                       [](const Posting& p, EntityId value) { return p.id < value; });
+            if (at == current.end() || at->id != id) {
+                return;  // word repeated in the same description
+            }
+            auto offset = at - current.begin();
+            PostingList& list = writable(it->second);
+            list.erase(list.begin() + offset);
+            --postingCount;
+            if (list.empty()) {
+                postingBytes -= list.capacity() * sizeof(Posting);
+                termBytes -= termFootprint(it->first);
+                map.erase(it);
+            }
+        });
+    }
+
+    // Ids of the transactions matching every word of the query and the
+    // filter, in ascending order; at most `limit` of them unless it is 0.
+    std::vector<EntityId> search(std::string_view query, const Filter& filter, size_t limit) const {
+        std::vector<Clause> clauses;
+        size_t start = 0;
+        while (start < query.size()) {
+            size_t end = query.find(' ', start);
+            if (end == std::string_view::npos) {
+                end = query.size();
+            }
+            std::string_view token = query.substr(start, end - start);
+            start = end + 1;
+            bool prefix = !token.empty() && token.back() == '*';
+            std::vector<std::string> words;
+            forEachWord(token, [&words](const std::string& word) { words.push_back(word); });
+            for (size_t i = 0; i < words.size(); ++i) {
+                clauses.push_back(findClause(words[i], prefix && i + 1 == words.size()));
+            }
+        }
+
+        std::vector<EntityId> result;
+        if (clauses.empty()) {
+            return result;
+        }
+        size_t totalLists = 0;
+        for (const Clause& clause : clauses) {
+            totalLists += clause.lists.size();
+        }
+        auto cost = [totalLists](const Clause& clause) {
+            return static_cast<double>(clause.postings) * static_cast<double>(totalLists - clause.lists.size() + 1);
+        };
+        auto driver = std::min_element(clauses.begin(), clauses.end(), [&cost](const Clause& a, const Clause& b) {
+            return cost(a) < cost(b);
+        });
+        std::swap(*driver, clauses.front());
+
+        auto accept = [&clauses, &filter](const Posting& posting) {
+            if (!filter.matches(posting)) {
+                return false;
+            }
+            for (size_t i = 1; i < clauses.size(); ++i) {
+                if (!clauses[i].contains(posting.id)) {
+                    return false;
+                }
+            }
+            return true;
+        };
+
+        const Clause& first = clauses.front();
+        if (first.lists.size() == 1 || limit == 0) {
+            for (const PostingList* list : first.lists) {
+                for (const Posting& posting : *list) {
+                    if (accept(posting)) {
+                        result.push_back(posting.id);
+                        if (first.lists.size() == 1 && result.size() == limit) {
+                            return result;
+                        }
+                    }
+                }
+            }
+            if (first.lists.size() > 1) {
+                // An id may be under several terms of a prefix.
+                std::sort(result.begin(), result.end());
+                result.erase(std::unique(result.begin(), result.end()), result.end());
+            }
+            return result;
+        }
+
+        // With a limit, merge the driver's lists in id order so the walk can
+        // stop early; an id under several terms is reported once.
+        using Cursor = std::pair<const Posting*, const Posting*>;
+        auto later = [](const Cursor& a, const Cursor& b) { return a.first->id > b.first->id; };
+        std::vector<Cursor> heap;
+        for (const PostingList* list : first.lists) {
+            heap.emplace_back(list->data(), list->data() + list->size());
+        }
+        std::make_heap(heap.begin(), heap.end(), later);
+        while (!heap.empty()) {
+            std::pop_heap(heap.begin(), heap.end(), later);
+            Cursor& cursor = heap.back();
+            const Posting& posting = *cursor.first;
+            if ((result.empty() || result.back() != posting.id) && accept(posting)) {
+                result.push_back(posting.id);
+                if (result.size() == limit) {
+                    break;
+                }
+            }
+            if (++cursor.first == cursor.second) {
+                heap.pop_back();
+            } else {
+                std::push_heap(heap.begin(), heap.end(), later);
+            }
+        }
+        return result;
+    }
+
+    size_t termCount() const { return terms->size(); }
+    size_t size() const { return postingCount; }
+
+    size_t memoryUsage() const {
+        return sizeof(DescriptionIndex) + termBytes + postingBytes;
+    }
+};
+
+enum class StorageFormat {
+    TEXT,
+    BINARY
+};
+
+// Columnar binary encoding of a transaction list:
+//   header   magic "PFTX", version, row count, string heap size
+//   columns  id, amount, transactionDate, createdAt, updatedAt (8 bytes per row),
+//            description offsets into the heap (8 bytes per row + 1),
+//            category (1 byte per row, padded to 8)
+//   heap     description bytes
+// Every section starts on an 8-byte boundary so columns can be read in place
+// from a mapped file. Values are stored in native byte order.
+class BinaryTransactionFormat {
+private:
+    static constexpr char MAGIC[4] = {'P', 'F', 'T', 'X'};
+    static const uint32_t VERSION = 2;
+
+    struct Header {
+        char magic[4];
+        uint32_t version;
+        uint64_t rowCount;
+        uint64_t heapSize;
+    };
+
+    // Fixed bytes per row: five 8-byte columns, a description offset and a category.
+    static const size_t ROW_BYTES = 5 * 8 + 8 + 1;
+
+    struct Layout {
+        size_t ids, amounts, dates, createdAts, updatedAts, descOffsets, categories, heap, end;
+
+        Layout(uint64_t rows, uint64_t heapSize) {
+            size_t n = static_cast<size_t>(rows);
+            ids = sizeof(Header);
+            amounts = ids + n * 8;
+            dates = amounts + n * 8;
+            createdAts = dates + n * 8;
+            updatedAts = createdAts + n * 8;
+            descOffsets = updatedAts + n * 8;
+            categories = descOffsets + (n + 1) * 8;
+            heap = categories + ((n + 7) & ~static_cast<size_t>(7));
+            end = heap + static_cast<size_t>(heapSize);
+        }
+    };
+
+    template <typename T>
+    static void put(std::string& out, size_t offset, T value) {
+        std::memcpy(&out[offset], &value, sizeof(T));
+    }
+
+    template <typename T>
+    static T get(std::string_view data, size_t offset) {
+        T value;
+        std::memcpy(&value, data.data() + offset, sizeof(T));
+        return value;
+    }
+
+    static Layout readLayout(std::string_view data) {
+        if (data.size() < sizeof(Header)) {
+            throw std::runtime_error("Invalid binary transaction file");
+        }
+        Header header;
+        std::memcpy(&header, data.data(), sizeof(Header));
+        if (std::memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0 || header.version != VERSION) {
+            throw std::runtime_error("Unsupported binary transaction file");
+        }
+        // Bound the counts by the file size first, so the layout cannot overflow.
+        size_t body = data.size() - sizeof(Header);
+        if (header.rowCount > body / ROW_BYTES || header.heapSize > body) {
+            throw std::runtime_error("Truncated binary transaction file");
+        }
+        Layout layout(header.rowCount, header.heapSize);
+        if (layout.end > data.size()) {
+            throw std::runtime_error("Truncated binary transaction file");
+        }
+        return layout;
+    }
+
+    static uint64_t rowCount(std::string_view data) {
+        return get<uint64_t>(data, offsetof(Header, rowCount));
+    }
+
+public:
+    static bool isBinary(std::string_view data) {
+        return data.size() >= sizeof(MAGIC) && std::memcmp(data.data(), MAGIC, sizeof(MAGIC)) == 0;
+    }
+
+    // Rows is std::vector<Transaction> or SharedChunks<Transaction>.
+    template <typename Rows>
+    static std::string encode(const Rows& transactions) {
+        uint64_t heapSize = 0;
+        for (const auto& trans : transactions) {
+            heapSize += trans.getDescription().size();
+        }
+
+        size_t n = transactions.size();
+        Layout layout(n, heapSize);
+        std::string out(layout.end, '\0');
+        Header header;
+        std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+        header.version = VERSION;
+        header.rowCount = n;
+        header.heapSize = heapSize;
+        std::memcpy(&out[0], &header, sizeof(Header));
+
+        uint64_t heapPos = 0;
+        for (size_t i = 0; i < n; ++i) {
+            const Transaction& trans = transactions[i];
+            put<uint64_t>(out, layout.ids + i * 8, trans.getId());
+            put<double>(out, layout.amounts + i * 8, trans.getAmount());
+            put<int64_t>(out, layout.dates + i * 8, trans.getDate());
+            put<int64_t>(out, layout.createdAts + i * 8, trans.getCreatedAt());
+            put<int64_t>(out, layout.updatedAts + i * 8, trans.getUpdatedAt());
+            out[layout.categories + i] = static_cast<char>(trans.getCategory());
+
+            std::string_view description = trans.getDescription();
+            put<uint64_t>(out, layout.descOffsets + i * 8, heapPos);
+            std::memcpy(&out[layout.heap + heapPos], description.data(), description.size());
+            heapPos += description.size();
+        }
+        put<uint64_t>(out, layout.descOffsets + n * 8, heapPos);
+        return out;
+    }
+
+    template <typename Rows>
+    static void decode(std::string_view data, Rows& transactions) {
+        Layout layout = readLayout(data);
+        size_t n = static_cast<size_t>(rowCount(data));
+        std::string_view heap = data.substr(layout.heap);
+
+        transactions.reserve(transactions.size() + n);
+        for (size_t i = 0; i < n; ++i) {
+            uint64_t descStart = get<uint64_t>(data, layout.descOffsets + i * 8);
+            uint64_t descEnd = get<uint64_t>(data, layout.descOffsets + (i + 1) * 8);
+            unsigned char category = static_cast<unsigned char>(data[layout.categories + i]);
+            if (descStart > descEnd || descEnd > heap.size() || category >= TransactionColumns::CATEGORY_COUNT) {
+                throw std::runtime_error("Corrupt binary transaction file");
+            }
+            transactions.emplace_back(
+                get<uint64_t>(data, layout.ids + i * 8),
+                get<double>(data, layout.amounts + i * 8),
+                static_cast<SpendingCategory>(category),
+                heap.substr(descStart, descEnd - descStart),
+                static_cast<time_t>(get<int64_t>(data, layout.dates + i * 8)),
+                static_cast<time_t>(get<int64_t>(data, layout.createdAts + i * 8)),
+                static_cast<time_t>(get<int64_t>(data, layout.updatedAts + i * 8)));
+        }
+    }
+};
+
+class BudgetLimit {
+public:
+    SpendingCategory category;
+    double limit;
+    
+    BudgetLimit(SpendingCategory cat, double lim) : category(cat), limit(lim) {}
+
+    std::string serialize() const {
+        return std::to_string(static_cast<int>(category)) + "," + std::to_string(limit);
+    }
+
+    static BudgetLimit deserialize(const std::string& data) {
+        std::stringstream ss(data);
+        std::string categoryStr, limitStr;
+        std::getline(ss, categoryStr, ',');
+        std::getline(ss, limitStr, ',');
+        return BudgetLimit(
+            static_cast<SpendingCategory>(std::stoi(categoryStr)),
+            std::stod(limitStr)
+        );
+    }
+};
+
+// Immutable view of an account at one version. Readers may keep it as long
+// as they like; the account never modifies a snapshot once published.
+class AccountSnapshot {
+public:
+    using CategoryTotals = TransactionColumns::CategoryTotals;
+    static const int CATEGORY_COUNT = TransactionColumns::CATEGORY_COUNT;
+
+    uint64_t version = 0;
+    EntityId accountId = 0;
+    std::string name;
+    double balance = 0.0;
+    double monthlyBudget = 0.0;
+    std::vector<BudgetLimit> categoryBudgets;
+    SharedChunks<Transaction> transactions;
+    TransactionColumns columns;
+    TransactionDateIndex dateIndex;
+    SharedChunks<Deposit> deposits;
+    std::shared_ptr<const BalanceHistory> balanceHistory;
+    DescriptionIndex descriptionIndex;
+    std::unordered_map<int, CategoryTotals> monthlySpending;
+    size_t bytes = 0;  // what the snapshot holds beyond the chunks it shares
+
+    // Ids of the transactions whose descriptions match the query; see
+    // DescriptionIndex for the query syntax.
+    std::vector<EntityId> searchTransactions(std::string_view query,
+                                             const DescriptionIndex::Filter& filter = DescriptionIndex::Filter(),
+                                             size_t limit = 0) const {
+        return descriptionIndex.search(query, filter, limit);
+    }
+
+    // Balance at the end of the day containing `date`: the current balance
+    // less everything recorded after that day.
+    double balanceAsOf(time_t date) const {
+        return balance - (balanceHistory->totalFlow() - balanceHistory->flowThrough(DateUtils::dayNumber(date)));
+    }
+
+    // Deposits minus spending over the days from `from` through `to`.
+    double netFlowBetween(time_t from, time_t to) const {
+        return balanceHistory->flowThrough(DateUtils::dayNumber(to)) -
+               balanceHistory->flowThrough(DateUtils::dayNumber(from) - 1);
+    }
+
+    // Range queries answer in place from dateIndex; the results stay valid as
+    // long as the snapshot is held.
+    TransactionDateIndex::Range transactionsBetween(time_t start, time_t end) const {
+        return dateIndex.between(start, end);
+    }
+
+    TransactionDateIndex::Range transactionsIn(const DateUtils::MonthRange& range) const {
+        return dateIndex.between(range.start, range.end);
+    }
+
+    TransactionDateIndex::Range lastDays(int days) const {
+        return transactionsIn(DateUtils::lastDays(days));
+    }
+
+    TransactionDateIndex::Range quarter(int year, int quarter) const {
+        return transactionsIn(DateUtils::quarterRange(year, quarter));
+    }
+
+    TransactionDateIndex::Range yearToDate() const {
+        return transactionsIn(DateUtils::yearToDate());
+    }
+
+    CategoryTotals spendingBetween(time_t start, time_t end) const {
+        return transactionsBetween(start, end).totalsByCategory();
+    }
+
+    double categorySpendingBetween(SpendingCategory category, time_t start, time_t end) const {
+        return transactionsBetween(start, end).total(category);
+    }
+
+    const CategoryTotals* currentMonthSpending() const {
+        auto it = monthlySpending.find(DateUtils::currentMonth().key);
+        return it != monthlySpending.end() ? &it->second : nullptr;
+    }
+
+    std::map<SpendingCategory, double> getCategorySpending() const {
+        std::map<SpendingCategory, double> categorySpending;
+        CategoryTotals totals;
+        std::array<bool, CATEGORY_COUNT> present;
+        columns.sumByCategory(totals, present);
+        for (int i = 0; i < CATEGORY_COUNT; ++i) {
+            if (present[i]) {
+                categorySpending[static_cast<SpendingCategory>(i)] = totals[i];
+            }
+        }
+        return categorySpending;
+    }
+
+    double getTotalMonthlySpending() const {
+        double total = 0.0;
+        if (const CategoryTotals* spending = currentMonthSpending()) {
+            for (double amount : *spending) {
+                total += amount;
+            }
+        }
+        return total;
+    }
+
+    // Bit c is set when totals[c] exceeds the budget of category c.
+    uint8_t getOverBudgetMask(const CategoryTotals& totals) const {
+        CategoryTotals limits;
+        limits.fill(std::numeric_limits<double>::infinity());
+        for (const auto& budget : categoryBudgets) {
+            int category = static_cast<int>(budget.category);
+            if (category >= 0 && category < CATEGORY_COUNT) {
+                limits[category] = budget.limit;
+            }
+        }
+        return SpendingKernels::overBudgetMask(totals.data(), limits.data());
+    }
+
+    bool isCategoryOverBudget(SpendingCategory category) const {
+        auto it = std::find_if(categoryBudgets.begin(), categoryBudgets.end(),
+                              [category](const BudgetLimit& budget) {
+                                  return budget.category == category;
+                              });
+        
+        if (it != categoryBudgets.end()) {
+            const CategoryTotals* spending = currentMonthSpending();
+            double categorySpending = spending ? (*spending)[static_cast<int>(category)] : 0.0;
+            return categorySpending > it->limit;
+        }
+        return false;
+    }
+
+    bool isOverBudget() const {
+        return getTotalMonthlySpending() > monthlyBudget;
+    }
+
+    // Writes the report from precomputed totals, so batch reporting can supply
+    // totals it aggregated elsewhere.
+    void writeFinancialReport(std::ostream& out, const std::map<SpendingCategory, double>& categorySpending,
+                              double monthlySpending) const {
+        out << "Financial Report for " << name << std::endl;
+        out << "Current Balance: $" << std::fixed << std::setprecision(2) << balance << std::endl;
+        out << "Monthly Budget: $" << monthlyBudget << std::endl;
+        
+        out << "\nCategory Spending and Budgets:" << std::endl;
+        CategoryTotals totals{};
+        for (const auto& [category, amount] : categorySpending) {
+            totals[static_cast<int>(category)] = amount;
+        }
+        uint8_t overBudget = getOverBudgetMask(totals);
+        for (const auto& [category, amount] : categorySpending) {
+            out << getCategoryString(category) << ": $" << amount;
+            
+            auto it = std::find_if(categoryBudgets.begin(), categoryBudgets.end(),
+                                 [category](const BudgetLimit& budget) {
+                                     return budget.category == category;
+                                 });
+            
+            if (it != categoryBudgets.end()) {
+                out << " (Budget: $" << it->limit;
+                if (overBudget & (1 << static_cast<int>(category))) {
+                    out << " - OVER BUDGET!";
+                }
+                out << ")";
+            }
+            out << std::endl;
+        }
+
+        out << "\nTotal Monthly Spending: $" << monthlySpending << std::endl;
+        if (monthlySpending > monthlyBudget) {
+            out << "WARNING: Over Monthly Budget!" << std::endl;
+        }
+    }
+};
+
+// Concurrency: every mutation holds writeMutex, so writes to one account are
+// serialized. Readers never take it on the fast path. Balance and budget are
+// published through atomics after each write, and everything else is read
+// from an immutable AccountSnapshot. A snapshot is built lazily, the first
+// time it is requested after a write. The bulk state lives in shared chunks
+// (SharedChunks, TransactionDateIndex), shared posting lists
+// (DescriptionIndex) and a shared BalanceHistory, so building one only
+// copies pointers under writeMutex; the account copies a piece when it next
+// writes to one a snapshot was given. The snapshot is published after the
+// lock is released.
+class Account : public BaseEntity {
+private:
+    std::string name;
+    double openingBalance;
+    double balance;
+    SharedChunks<Transaction> transactions;
+    std::unordered_map<EntityId, size_t> transactionSlots;
+    TransactionColumns columns;
+    TransactionDateIndex dateIndex;
+    SharedChunks<Deposit> deposits;
+    SharedValue<BalanceHistory> balanceHistory = SharedValue<BalanceHistory>::make();
+    DescriptionIndex descriptionIndex;
+    double monthlyBudget;
+    std::vector<BudgetLimit> categoryBudgets;
+    std::string dataPath;
+    std::atomic<StorageFormat> storageFormat;
+
+    mutable std::mutex writeMutex;
+    std::atomic<uint64_t> version{0};
+    std::atomic<double> publishedBalance{0.0};
+    std::atomic<double> publishedMonthlyBudget{0.0};
+    std::atomic<size_t> residentBytes{0};
+    mutable std::shared_ptr<const AccountSnapshot> published;  // accessed with std::atomic_load/store
+
+    // Ends every mutation: makes the new state visible to readers. Caller
+    // holds writeMutex.
+    void publish() {
+        descriptionIndex.normalize();
+        publishedBalance.store(balance, std::memory_order_relaxed);
+        publishedMonthlyBudget.store(monthlyBudget, std::memory_order_relaxed);
+        residentBytes.store(liveMemoryUsage(), std::memory_order_relaxed);
+        version.fetch_add(1, std::memory_order_release);
+    }
+
+    // balanceHistory for writing, copied first if a snapshot was given it.
+    BalanceHistory& history() { return balanceHistory.write(); }
+
+    // Caller holds writeMutex.
+    std::shared_ptr<const AccountSnapshot> buildSnapshot() const {
+        auto snapshot = std::make_shared<AccountSnapshot>();
+        snapshot->version = version.load(std::memory_order_relaxed);
+        snapshot->accountId = id;
+        snapshot->name = name;
+        snapshot->balance = balance;
+        snapshot->monthlyBudget = monthlyBudget;
+        snapshot->categoryBudgets = categoryBudgets;
+        snapshot->transactions = transactions;
+        snapshot->columns = columns;
+        snapshot->dateIndex = dateIndex;
+        snapshot->deposits = deposits;
+        snapshot->balanceHistory = balanceHistory.share();
+        snapshot->descriptionIndex = descriptionIndex;
+        snapshot->monthlySpending = monthlySpending;
+        // Shared chunks and posting lists are counted once, with the live state.
+        snapshot->bytes = sizeof(AccountSnapshot) + snapshot->name.capacity() +
+                          monthlySpending.size() * (sizeof(std::pair<const int, CategoryTotals>) + 2 * sizeof(void*)) +
+                          categoryBudgets.size() * sizeof(BudgetLimit);
+        return snapshot;
+    }
+
+    std::string infoFile() const {
+        return dataPath + "/account_" + std::to_string(id) + ".txt";
+    }
+
+    // Account details: "balance,openingBalance,monthlyBudget,storageFormat,createdAt,updatedAt,name".
+    // The balance here only serves listings of accounts that are not loaded;
+    // it is written separately from the journal and deposit appends, so
+    // loading derives it from the opening balance instead.
+    void saveAccountInfo() {
+        std::stringstream ss;
+        ss << formatNumber(balance) << "," << formatNumber(openingBalance) << "," << formatNumber(monthlyBudget) << ","
+           << static_cast<int>(storageFormat.load()) << "," << createdAt << "," << updatedAt << "," << name << "\n";
+        FileManager::saveToFile(infoFile(), ss.str());
+    }
+
+    // Transactions are persisted as a base snapshot plus an append-only journal.
+    // Each mutation appends one record to the journal; once the journal grows
+    // past the size of the snapshot it is compacted back into the base file.
+    static const size_t JOURNAL_COMPACTION_MIN = 1024;
+    static const size_t JOURNAL_TAIL_BYTES = 64;
+    size_t journalRecords = 0;
+    size_t snapshotRecords = 0;
+    // Bytes of the journal reflected in memory, and the last of them, to
+    // check that a journal which grew was only appended to.
+    size_t journalBytes = 0;
+    std::string journalTail;
+
+    // Interned descriptions in use, each charged to the account once however
+    // many transactions share it; keyed by StringPool::Ref::key().
+    std::unordered_map<const void*, size_t> descriptionUses;
+    size_t descriptionBytes = 0;
+
+    void chargeDescription(const Transaction& trans) {
+        const StringPool::Ref& text = trans.getDescriptionRef();
+        if (text.key() && descriptionUses[text.key()]++ == 0) {
+            descriptionBytes += text.footprint();
+        }
+    }
+
+    void unchargeDescription(const Transaction& trans) {
+        const StringPool::Ref& text = trans.getDescriptionRef();
+        auto it = descriptionUses.find(text.key());
+        if (it != descriptionUses.end() && --it->second == 0) {
+            descriptionBytes -= text.footprint();
+            descriptionUses.erase(it);
+        }
+    }
+
+    // transactionSlots maps each id to its index in transactions. Deletes move
+    // the last transaction into the freed slot so both stay dense.
+    void insertTransaction(const Transaction& transaction) {
+        auto it = transactionSlots.find(transaction.getId());
+        if (it != transactionSlots.end()) {
+            dateIndex.erase(transactions[it->second]);
+            history().add(transactions[it->second].getDate(), transactions[it->second].getAmount());
+            descriptionIndex.remove(transactions[it->second]);
+            unchargeDescription(transactions[it->second]);
+            chargeDescription(transaction);
+            transactions.write(it->second) = transaction;
+            columns.set(it->second, transaction);
+            dateIndex.insert(transaction);
+            descriptionIndex.add(transaction);
+            history().add(transaction.getDate(), -transaction.getAmount());
+            return;
+        }
+        transactionSlots.emplace(transaction.getId(), transactions.size());
+        chargeDescription(transaction);
+        transactions.push_back(transaction);
+        columns.push(transaction);
+        dateIndex.insert(transaction);
+        history().add(transaction.getDate(), -transaction.getAmount());
+        descriptionIndex.add(transaction);
+    }
+
+    void removeTransactionAt(size_t slot) {
+        dateIndex.erase(transactions[slot]);
+        history().add(transactions[slot].getDate(), transactions[slot].getAmount());
+        descriptionIndex.remove(transactions[slot]);
+        unchargeDescription(transactions[slot]);
+        transactionSlots.erase(transactions[slot].getId());
+        if (slot + 1 != transactions.size()) {
+            transactions.write(slot) = transactions.back();
+            transactionSlots[transactions[slot].getId()] = slot;
+        }
+        transactions.pop_back();
+        columns.removeAt(slot);
+    }
+
+    void rebuildTransactionSlots() {
+        transactionSlots.clear();
+        transactionSlots.reserve(transactions.size());
+        columns.clear();
+        columns.reserve(transactions.size());
+        balanceHistory = SharedValue<BalanceHistory>::make();
+        descriptionIndex.clear();
+        descriptionUses.clear();
+        descriptionBytes = 0;
+        for (size_t i = 0; i < transactions.size(); ++i) {
+            transactionSlots[transactions[i].getId()] = i;
+            chargeDescription(transactions[i]);
+            columns.push(transactions[i]);
+            history().add(transactions[i].getDate(), -transactions[i].getAmount());
+            descriptionIndex.add(transactions[i]);
+        }
+        for (const auto& deposit : deposits) {
+            history().add(deposit.date, deposit.amount);
+        }
+        dateIndex.build(columns);
+    }
+
+    size_t findTransactionSlot(EntityId transId) const {
+        auto it = transactionSlots.find(transId);
+        if (it == transactionSlots.end()) {
+            throw std::runtime_error("Transaction not found");
+        }
+        return it->second;
+    }
+
+    // Running spending totals per (year, month) bucket, one lane per category.
+    // Kept in step with every mutation so budget checks are simple lookups.
+    static const int CATEGORY_COUNT = TransactionColumns::CATEGORY_COUNT;
+    using CategoryTotals = TransactionColumns::CategoryTotals;
+    std::unordered_map<int, CategoryTotals> monthlySpending;
+
+    void addToMonthlySpending(const Transaction& trans, double sign) {
+        int category = static_cast<int>(trans.getCategory());
+        if (category < 0 || category >= CATEGORY_COUNT) {
+            return;
+        }
+        auto it = monthlySpending.try_emplace(DateUtils::monthKey(trans.getDate())).first;
+        it->second[category] += sign * trans.getAmount();
+    }
+
+    void rebuildMonthlySpending() {
+        monthlySpending.clear();
+        for (size_t b = 0; b < columns.blockCount(); ++b) {
+            TransactionColumns::Block rows = columns.block(b);
+            for (size_t i = 0; i < rows.rows; ++i) {
+                if (rows.categories[i] < CATEGORY_COUNT) {
+                    monthlySpending[DateUtils::monthKey(static_cast<time_t>(rows.dates[i]))][rows.categories[i]] +=
+                        rows.amounts[i];
+                }
+            }
+        }
+    }
+
+    // File generations the in-memory transactions were last synced with.
+    uint64_t transactionsGeneration = 0;
+    uint64_t journalGeneration = 0;
+
+    std::string transactionsFile() const {
+        return transactionsFile(storageFormat);
+    }
+
+    std::string transactionsFile(StorageFormat format) const {
+        return dataPath + "/transactions_" + std::to_string(id) + (format == StorageFormat::BINARY ? ".bin" : ".txt");
+    }
+
+    std::string journalFile() const {
+        return dataPath + "/journal_" + std::to_string(id) + ".txt";
+    }
+
+    // Deposits are append-only, one "id,amount,date" line each.
+    std::string depositsFile() const {
+        return dataPath + "/deposits_" + std::to_string(id) + ".txt";
+    }
+
+    void loadDeposits() {
+        deposits.clear();
+        MappedFile file(depositsFile());
+        MappedFile::forEachLine(file.view(), [this](std::string_view line) {
+            deposits.push_back(Deposit::deserialize(line));
+        });
+    }
+
+    void saveTransactions() {
+        saveTransactions(storageFormat);
+        // The journal may only be truncated once the new base is durable.
+        FileManager::flush();
+        truncateJournal();
+        markTransactionsSynced();
+    }
+
+    void truncateJournal() {
+        FileManager::saveToFile(journalFile(), "");
+        FileManager::flush();
+        journalRecords = 0;
+        snapshotRecords = transactions.size();
+        journalBytes = 0;
+        journalTail.clear();
+    }
+
+    void noteJournalBytes(std::string_view appended) {
+        journalBytes += appended.size();
+        journalTail.append(appended.substr(appended.size() - std::min(appended.size(), JOURNAL_TAIL_BYTES)));
+        if (journalTail.size() > JOURNAL_TAIL_BYTES) {
+            journalTail.erase(0, journalTail.size() - JOURNAL_TAIL_BYTES);
+        }
+    }
+
+    void saveTransactions(StorageFormat format) {
+        if (format == StorageFormat::BINARY) {
+            FileManager::saveToFile(transactionsFile(format), BinaryTransactionFormat::encode(transactions));
+        } else {
+            std::string content;
+            for (const auto& trans : transactions) {
+                trans.appendSerialized(content);
+                content += '\n';
+            }
+            FileManager::saveToFile(transactionsFile(format), content);
+        }
+    }
+
+    void markTransactionsSynced() {
+        transactionsGeneration = FileManager::getGeneration(transactionsFile());
+        journalGeneration = FileManager::getGeneration(journalFile());
+    }
+
+    bool transactionsStale() const {
+        return FileManager::getGeneration(transactionsFile()) != transactionsGeneration ||
+               FileManager::getGeneration(journalFile()) != journalGeneration;
+    }
+
+    // Journal records: "+,<transaction>" adds or replaces, "-,<id>" deletes.
+    // Deletes are replayed with the same swap-and-pop as the live path, so a
+    // reload reproduces the in-memory order exactly.
+    void appendJournal(const std::string& records, size_t count) {
+        FileManager::appendToFile(journalFile(), records);
+        journalRecords += count;
+        noteJournalBytes(records);
+        if (journalRecords >= std::max(JOURNAL_COMPACTION_MIN, snapshotRecords)) {
+            saveTransactions();
+        } else {
+            markTransactionsSynced();
+        }
+    }
+
+    void loadTransactions() {
+        // Sync before reading so a concurrent external write triggers another reload.
+        markTransactionsSynced();
+        MappedFile base(transactionsFile());
+        std::string_view content = base.view();
+
+        transactions.clear();
+        if (storageFormat == StorageFormat::BINARY) {
+            if (!content.empty()) {
+                BinaryTransactionFormat::decode(content, transactions);
+            }
+        } else {
+            transactions.reserve(std::count(content.begin(), content.end(), '\n') + 1);
+            MappedFile::forEachLine(content, [this](std::string_view line) {
+                transactions.push_back(Transaction::deserialize(line));
+            });
+        }
+
+        rebuildTransactionSlots();
+        snapshotRecords = transactions.size();
+
+        // Replay is idempotent so a crash between rewriting the base file and
+        // truncating the journal only re-applies records already compacted.
+        journalRecords = 0;
+        journalBytes = 0;
+        journalTail.clear();
+        MappedFile journal(journalFile());
+        replayJournal(journal.view(), false);
+        rebuildMonthlySpending();
+        balance = replayedBalance();
+    }
+
+    // Applies journal records on top of the loaded state. With `track` set
+    // the balance and the monthly index follow each record; a full load
+    // rebuilds them once afterwards instead.
+    void replayJournal(std::string_view records, bool track) {
+        MappedFile::forEachLine(records, [this, track](std::string_view line) {
+            if (line.size() < 2 || line[1] != ',') {
+                return;
+            }
+            std::string_view payload = line.substr(2);
+            if (line[0] == '+') {
+                Transaction trans = Transaction::deserialize(payload);
+                auto it = transactionSlots.find(trans.getId());
+                if (track && it != transactionSlots.end()) {
+                    addToMonthlySpending(transactions[it->second], -1.0);
+                    balance += transactions[it->second].getAmount();
+                }
+                if (track) {
+                    addToMonthlySpending(trans, 1.0);
+                    balance -= trans.getAmount();
+                }
+                insertTransaction(trans);
+            } else if (line[0] == '-') {
+                EntityId removedId;
+                if (parseNumber(payload, removedId)) {
+                    auto it = transactionSlots.find(removedId);
+                    if (it != transactionSlots.end()) {
+                        if (track) {
+                            addToMonthlySpending(transactions[it->second], -1.0);
+                            balance += transactions[it->second].getAmount();
+                        }
+                        removeTransactionAt(it->second);
+                    }
+                }
+            }
+            ++journalRecords;
+        });
+        noteJournalBytes(records);
+    }
+
+    // Replays only what was appended to the journal since it was last read,
+    // when that is all that changed: the base file is as it was, and the
+    // journal grew and still holds the bytes it ended with.
+    bool replayJournalTail() {
+        if (FileManager::getGeneration(transactionsFile()) != transactionsGeneration) {
+            return false;
+        }
+        uint64_t generation = FileManager::getGeneration(journalFile());
+        MappedFile journal(journalFile());
+        std::string_view content = journal.view();
+        if (content.size() <= journalBytes ||
+            content.substr(journalBytes - journalTail.size(), journalTail.size()) != journalTail) {
+            return false;
+        }
+        journalGeneration = generation;
+        replayJournal(content.substr(journalBytes), true);
+        return true;
+    }
+
+    double replayedBalance() const {
+        double total = openingBalance;
+        for (const auto& deposit : deposits) {
+            total += deposit.amount;
+        }
+        for (const auto& trans : transactions) {
+            total -= trans.getAmount();
+        }
+        return total;
+    }
+
+    void saveBudgetLimits() {
+        std::string filename = dataPath + "/budgets_" + std::to_string(id) + ".txt";
+        std::stringstream ss;
+        for (const auto& budget : categoryBudgets) {
+            ss << budget.serialize() << "\n";
+        }
+        FileManager::saveToFile(filename, ss.str());
+    }
+
+    void loadBudgetLimits() {
+        std::string filename = dataPath + "/budgets_" + std::to_string(id) + ".txt";
+        std::string content = FileManager::readFromFile(filename);
+        std::stringstream ss(content);
+        std::string line;
+        
+        categoryBudgets.clear();
+        while (std::getline(ss, line)) {
+            if (!line.empty()) {
+                categoryBudgets.push_back(BudgetLimit::deserialize(line));
+            }
+        }
+    }
+
+public:
+    Account(const std::string& accountName, double initialBalance = 0.0, double budget = 0.0,
+            StorageFormat format = StorageFormat::TEXT)
+        : BaseEntity(), name(accountName), openingBalance(initialBalance), balance(initialBalance), monthlyBudget(budget),
+          storageFormat(format) {
+        dataPath = "data/accounts/" + std::to_string(id);
+        FileManager::createDirectory(dataPath);
+        saveTransactions();
+        saveBudgetLimits();
+        saveAccountInfo();
+        publish();
+    }
+
+    struct Info {
+        std::string name;
+        double balance;
+        double openingBalance;
+        double monthlyBudget;
+        StorageFormat storageFormat;
+        time_t createdAt;
+        time_t updatedAt;
+    };
+
+    // Reads only the account details file, without touching transactions.
+    static Info readInfo(EntityId accountId) {
+        std::string dir = "data/accounts/" + std::to_string(accountId);
+        std::string content = FileManager::readFromFile(dir + "/account_" + std::to_string(accountId) + ".txt");
+        std::string_view fields[6];
+        std::string_view rest(content);
+        if (!rest.empty() && rest.back() == '\n') {
+            rest.remove_suffix(1);
+        }
+        for (auto& field : fields) {
+            size_t comma = rest.find(',');
+            if (comma == std::string_view::npos) {
+                throw std::runtime_error("Account not found: " + std::to_string(accountId));
+            }
+            field = rest.substr(0, comma);
+            rest.remove_prefix(comma + 1);
+        }
+        Info info;
+        int format;
+        long long created, updated;
+        if (!parseNumber(fields[0], info.balance) || !parseNumber(fields[1], info.openingBalance) ||
+            !parseNumber(fields[2], info.monthlyBudget) || !parseNumber(fields[3], format) ||
+            !parseNumber(fields[4], created) || !parseNumber(fields[5], updated) || format < 0 ||
+            format > static_cast<int>(StorageFormat::BINARY)) {
+            throw std::runtime_error("Invalid account data format");
+        }
+        info.name = std::string(rest);
+        info.storageFormat = static_cast<StorageFormat>(format);
+        info.createdAt = static_cast<time_t>(created);
+        info.updatedAt = static_cast<time_t>(updated);
+        return info;
+    }
+
+    // Loads an existing account with its budgets and transactions.
+    explicit Account(EntityId accountId) : Account(accountId, readInfo(accountId)) {}
+
+    Account(EntityId accountId, const Info& info)
+        : BaseEntity(accountId, info.createdAt, info.updatedAt), name(info.name), openingBalance(info.openingBalance),
+          balance(info.balance), monthlyBudget(info.monthlyBudget), storageFormat(info.storageFormat) {
+        dataPath = "data/accounts/" + std::to_string(id);
+        loadBudgetLimits();
+        loadDeposits();
+        loadTransactions();
+        if (balance != info.balance) {
+            // A crash landed between a row append and the info file update.
+            saveAccountInfo();
+        }
+        publish();
+    }
+
+    Account(const Account&) = delete;
+    Account& operator=(const Account&) = delete;
+
+    // Returns the current state without blocking writers unless it has to be
+    // rebuilt after a write.
+    std::shared_ptr<const AccountSnapshot> snapshot() const {
+        std::shared_ptr<const AccountSnapshot> current = std::atomic_load(&published);
+        if (current && current->version == version.load(std::memory_order_acquire)) {
+            return current;
+        }
+        {
+            std::lock_guard<std::mutex> lock(writeMutex);
+            current = std::atomic_load(&published);
+            if (current && current->version == version.load(std::memory_order_relaxed)) {
+                return current;
+            }
+            current = buildSnapshot();
+        }
+        // Another reader may have published a newer version meanwhile.
+        std::shared_ptr<const AccountSnapshot> seen = std::atomic_load(&published);
+        while ((!seen || seen->version < current->version) &&
+               !std::atomic_compare_exchange_weak(&published, &seen, current)) {
+        }
+        return current;
+    }
+
+    // Catches up with changes made to the files since they were last read or
+    // written: appended journal records are replayed, anything else reloads.
+    void refresh() {
+        std::lock_guard<std::mutex> lock(writeMutex);
+        if (transactionsStale()) {
+            if (!replayJournalTail()) {
+                loadTransactions();
+            }
+            publish();
+        }
+    }
+
+    void addTransaction(const Transaction& transaction) {
+        std::lock_guard<std::mutex> lock(writeMutex);
+        insertTransaction(transaction);
+        addToMonthlySpending(transaction, 1.0);
+        balance -= transaction.getAmount();
+        updateTimestamp();
+        appendJournal("+," + transaction.serialize() + "\n", 1);
+        saveAccountInfo();
+        publish();
+    }
+
+    // Adds a batch with one persistence pass: a single journal append, or a
+    // rewrite of the base file when the batch would trigger compaction anyway.
+    void addTransactions(const std::vector<Transaction>& batch) {
+        if (batch.empty()) {
+            return;
+        }
+        std::lock_guard<std::mutex> lock(writeMutex);
+        for (const auto& transaction : batch) {
+            insertTransaction(transaction);
+            addToMonthlySpending(transaction, 1.0);
+            balance -= transaction.getAmount();
+        }
+        updateTimestamp();
+        if (journalRecords + batch.size() >= std::max(JOURNAL_COMPACTION_MIN, snapshotRecords)) {
+            saveTransactions();
+        } else {
+            std::string records;
+            for (const auto& transaction : batch) {
+                records += "+,";
+                transaction.appendSerialized(records);
+                records += '\n';
+            }
+            appendJournal(records, batch.size());
+        }
+        saveAccountInfo();
+        publish();
+    }
+
+    void editTransaction(EntityId transId, double newAmount, 
+                        SpendingCategory newCategory, const std::string& newDescription) {
+        std::lock_guard<std::mutex> lock(writeMutex);
+        size_t slot = findTransactionSlot(transId);
+        Transaction& trans = transactions.write(slot);
+        double oldAmount = trans.getAmount();
+        balance += oldAmount;
+        addToMonthlySpending(trans, -1.0);
+
+        descriptionIndex.remove(trans);
+        unchargeDescription(trans);
+        trans.update(newAmount, newCategory, newDescription);
+        chargeDescription(trans);
+        columns.set(slot, trans);
+        dateIndex.update(trans);
+        descriptionIndex.add(trans);
+        history().add(trans.getDate(), oldAmount - newAmount);
+        addToMonthlySpending(trans, 1.0);
+        balance -= newAmount;
+        updateTimestamp();
+        appendJournal("+," + trans.serialize() + "\n", 1);
+        saveAccountInfo();
+        publish();
+    }
+
+    void deleteTransaction(EntityId transId) {
+        std::lock_guard<std::mutex> lock(writeMutex);
+        size_t slot = findTransactionSlot(transId);
+        balance += transactions[slot].getAmount();
+        addToMonthlySpending(transactions[slot], -1.0);
+        removeTransactionAt(slot);
+        updateTimestamp();
+        appendJournal("-," + std::to_string(transId) + "\n", 1);
+        saveAccountInfo();
+        publish();
+    }
+
+    // Switches the base file to another format. Each step is durable before
+    // the next, so a crash leaves either the old base or the new one named in
+    // the info file, with the journal still replaying on top of it.
+    void setStorageFormat(StorageFormat format) {
+        std::lock_guard<std::mutex> lock(writeMutex);
+        if (format == storageFormat) {
+            return;
+        }
+        std::string oldFile = transactionsFile();
+        saveTransactions(format);
+        FileManager::flush();
+        storageFormat = format;
+        saveAccountInfo();
+        FileManager::flush();
+        truncateJournal();
+        FileManager::removeFile(oldFile);
+        markTransactionsSynced();
+        publish();
+    }
+
+    StorageFormat getStorageFormat() const {
+        return storageFormat;
+    }
+
+    // Approximate resident size: the live state plus the published snapshot.
+    size_t estimateMemoryUsage() const {
+        size_t bytes = residentBytes.load(std::memory_order_relaxed);
+        if (std::shared_ptr<const AccountSnapshot> current = std::atomic_load(&published)) {
+            bytes += current->bytes;
+        }
+        return bytes;
+    }
+
+private:
+    // The object and its containers, plus the interned descriptions it uses.
+    // Caller holds writeMutex.
+    size_t liveMemoryUsage() const {
+        size_t bytes = sizeof(Account) + name.capacity() + dataPath.capacity();
+        bytes += transactions.memoryUsage();
+        bytes += columns.memoryUsage();
+        bytes += dateIndex.memoryUsage();
+        bytes += deposits.memoryUsage() + balanceHistory->memoryUsage();
+        bytes += descriptionIndex.memoryUsage();
+        bytes += descriptionBytes;
+        // Hash nodes hold the key/value pair plus a next pointer and cached hash.
+        bytes += descriptionUses.size() * (sizeof(std::pair<const void* const, size_t>) + 2 * sizeof(void*));
+        bytes += descriptionUses.bucket_count() * sizeof(void*);
+        bytes += transactionSlots.size() * (sizeof(std::pair<const EntityId, size_t>) + 2 * sizeof(void*));
+        bytes += transactionSlots.bucket_count() * sizeof(void*);
+        bytes += monthlySpending.size() * (sizeof(std::pair<const int, CategoryTotals>) + 2 * sizeof(void*));
+        bytes += monthlySpending.bucket_count() * sizeof(void*);
+        bytes += categoryBudgets.capacity() * sizeof(BudgetLimit);
+        return bytes;
+    }
+
+public:
+
+    std::vector<std::string> getDataFiles() const {
+        return {transactionsFile(), journalFile(), depositsFile(), dataPath + "/budgets_" + std::to_string(id) + ".txt",
+                infoFile()};
+    }
+
+    // True while some of this account's writes are still queued.
+    bool isDirty() const {
+        for (const auto& file : getDataFiles()) {
+            if (FileManager::hasPendingWrites(file)) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void flush() {
+        for (const auto& file : getDataFiles()) {
+            FileManager::ensureFlushed(file);
+        }
+    }
+
+    void setCategoryBudget(SpendingCategory category, double limit) {
+        std::lock_guard<std::mutex> lock(writeMutex);
+        auto it = std::find_if(categoryBudgets.begin(), categoryBudgets.end(),
+                              [category](const BudgetLimit& budget) {
+                                  return budget.category == category;
+                              });
+        
+        if (it != categoryBudgets.end()) {
+            it->limit = limit;
+        } else {
+            categoryBudgets.push_back(BudgetLimit(category, limit));
+        }
+        saveBudgetLimits();
+        publish();
+    }
+
+    void deleteCategoryBudget(SpendingCategory category) {
+        std::lock_guard<std::mutex> lock(writeMutex);
+        categoryBudgets.erase(
+            std::remove_if(categoryBudgets.begin(), categoryBudgets.end(),
+                          [category](const BudgetLimit& budget) {
+                              return budget.category == category;
+                          }),
+            categoryBudgets.end()
+        );
+        saveBudgetLimits();
+        publish();
+    }
+
+    std::vector<BudgetLimit> getCategoryBudgets() const {
+        return snapshot()->categoryBudgets;
+    }
+
+    bool isCategoryOverBudget(SpendingCategory category) const {
+        return snapshot()->isCategoryOverBudget(category);
+    }
+
+    // Records a deposit, optionally backdated.
+    void deposit(double amount, time_t date = std::time(nullptr)) {
+        if (amount > 0) {
+            std::lock_guard<std::mutex> lock(writeMutex);
+            deposits.emplace_back(IdGenerator::next(), amount, date);
+            history().add(date, amount);
+            balance += amount;
+            updateTimestamp();
+            std::string record;
+            deposits.back().appendSerialized(record);
+            record += '\n';
+            FileManager::appendToFile(depositsFile(), record);
+            saveAccountInfo();
+            publish();
+        }
+    }
+
+    void setMonthlyBudget(double budget) {
+        std::lock_guard<std::mutex> lock(writeMutex);
+        monthlyBudget = budget;
+        updateTimestamp();
+        saveAccountInfo();
+        publish();
+    }
+
+    std::string getName() const { return name; }
+    double getBalance() const { return publishedBalance.load(std::memory_order_relaxed); }
+
+    double getMonthlyBudget() const {
+        return publishedMonthlyBudget.load(std::memory_order_relaxed);
+    }
+
+    std::map<SpendingCategory, double> getCategorySpending() const {
+        return snapshot()->getCategorySpending();
+    }
+
+    double getTotalMonthlySpending() const {
+        return snapshot()->getTotalMonthlySpending();
+    }
+
+    bool isOverBudget() const {
+        return snapshot()->isOverBudget();
+    }
+
+    void printFinancialReport() const {
+        std::shared_ptr<const AccountSnapshot> current = snapshot();
+        current->writeFinancialReport(std::cout, current->getCategorySpending(), current->getTotalMonthlySpending());
+    }
+};
+
+// Process-wide LRU cache of loaded accounts with a memory budget. When the
+// estimated footprint of the cached accounts exceeds the budget, the least
+// recently used accounts are dropped, after flushing any queued writes.
+// Accounts still referenced outside the cache (e.g. the selected account) are
+// never evicted, so there is only ever one live Account per id.
+//
+// Disk I/O happens outside the registry mutex. An account being loaded, or
+// being flushed on its way out, is registered as in flight; other callers
+// asking for it wait for that one operation instead of starting their own.
+class AccountCache {
+public:
+    static const size_t DEFAULT_MEMORY_BUDGET = 256 * 1024 * 1024;
+
+    struct Stats {
+        uint64_t hits = 0;
+        uint64_t misses = 0;
+        uint64_t evictions = 0;
+        size_t residentAccounts = 0;
+        size_t residentBytes = 0;
+        size_t memoryBudget = 0;
+    };
+
+private:
+    struct Entry {
+        EntityId id;
+        std::shared_ptr<Account> account;
+        size_t bytes;
+    };
+
+    using Pending = std::shared_future<std::shared_ptr<Account>>;
+
+    // An evicted account, held until the registry mutex is released so that
+    // it is destroyed outside it. A dirty one stays in flight until its
+    // queued writes are flushed.
+    struct Eviction {
+        std::shared_ptr<Account> account;
+        bool dirty;
+        std::promise<std::shared_ptr<Account>> done;
+    };
+
+    struct Registry {
+        std::mutex mutex;
+        std::list<Entry> entries;  // most recently used first
+        std::unordered_map<EntityId, std::list<Entry>::iterator> byId;
+        std::unordered_map<EntityId, Pending> inFlight;  // loading or flushing
+        size_t memoryBudget = DEFAULT_MEMORY_BUDGET;
+        Stats stats;
+    };
+
+    static Registry& registry() {
+        static Registry instance;
+        return instance;
+    }
+
+    // Drops least recently used accounts until the cache fits its budget.
+    // They are returned for finishEvictions() to flush the dirty ones, still
+    // in flight, once the mutex is released. Caller holds the registry mutex.
+    static std::vector<Eviction> trim(Registry& r) {
+        std::vector<Eviction> evictions;
+        size_t total = 0;
+        for (auto& entry : r.entries) {
+            entry.bytes = entry.account->estimateMemoryUsage();
+            total += entry.bytes;
+        }
+        auto it = r.entries.end();
+        while (total > r.memoryBudget && it != r.entries.begin()) {
+            --it;
+            if (it->account.use_count() > 1) {
+                continue;
+            }
+            evictions.push_back(Eviction{it->account, it->account->isDirty(), {}});
+            if (evictions.back().dirty) {
+                r.inFlight[it->id] = evictions.back().done.get_future().share();
+            }
+            total -= it->bytes;
+            r.byId.erase(it->id);
+            it = r.entries.erase(it);
+            ++r.stats.evictions;
+        }
+        return evictions;
+    }
+
+    static void finishEvictions(Registry& r, std::vector<Eviction>& evictions) {
+        for (auto& eviction : evictions) {
+            if (!eviction.dirty) {
+                continue;
+            }
+            std::exception_ptr failure;
+            try {
+                eviction.account->flush();
+            } catch (...) {
+                failure = std::current_exception();
+            }
+            {
+                std::lock_guard<std::mutex> lock(r.mutex);
+                r.inFlight.erase(eviction.account->getId());
+            }
+            // Waiters take the account back, so a failed flush loses nothing.
+            eviction.done.set_value(eviction.account);
+            if (failure) {
+                std::cerr << "Failed to flush evicted account: " << eviction.account->getId() << std::endl;
+            }
+        }
+    }
+
+    // Makes `account` the most recently used entry for its id, unless another
+    // caller got there first, and returns the resident one. Caller holds the
+    // registry mutex.
+    static std::shared_ptr<Account> admit(Registry& r, const std::shared_ptr<Account>& account) {
+        auto it = r.byId.find(account->getId());
+        if (it != r.byId.end()) {
+            r.entries.splice(r.entries.begin(), r.entries, it->second);
+        } else {
+            r.entries.push_front(Entry{account->getId(), account, 0});
+            r.byId[account->getId()] = r.entries.begin();
+        }
+        return r.entries.front().account;
+    }
+
+public:
+    // Returns the cached account, loading it from disk on a miss.
+    static std::shared_ptr<Account> get(EntityId accountId) {
+        Registry& r = registry();
+        std::unique_lock<std::mutex> lock(r.mutex);
+        auto it = r.byId.find(accountId);
+        if (it != r.byId.end()) {
+            ++r.stats.hits;
+            r.entries.splice(r.entries.begin(), r.entries, it->second);
+            return it->second->account;
+        }
+
+        std::shared_ptr<Account> account;
+        auto pending = r.inFlight.find(accountId);
+        if (pending != r.inFlight.end()) {
+            ++r.stats.hits;
+            Pending result = pending->second;
+            lock.unlock();
+            account = result.get();
+        } else {
+            ++r.stats.misses;
+            std::promise<std::shared_ptr<Account>> loaded;
+            r.inFlight[accountId] = loaded.get_future().share();
+            lock.unlock();
+            try {
+                account = std::make_shared<Account>(accountId);
+            } catch (...) {
+                lock.lock();
+                r.inFlight.erase(accountId);
+                lock.unlock();
+                loaded.set_exception(std::current_exception());
+                throw;
+            }
+            lock.lock();
+            r.inFlight.erase(accountId);
+            lock.unlock();
+            loaded.set_value(account);
+        }
+
+        lock.lock();
+        account = admit(r, account);
+        std::vector<Eviction> evictions = trim(r);
+        lock.unlock();
+        finishEvictions(r, evictions);
+        return account;
+    }
+
+    static void put(const std::shared_ptr<Account>& account) {
+        Registry& r = registry();
+        std::vector<Eviction> evictions;
+        {
+            std::lock_guard<std::mutex> lock(r.mutex);
+            auto it = r.byId.find(account->getId());
+            if (it != r.byId.end()) {
+                r.entries.erase(it->second);
+            }
+            r.entries.push_front(Entry{account->getId(), account, 0});
+            r.byId[account->getId()] = r.entries.begin();
+            evictions = trim(r);
+        }
+        finishEvictions(r, evictions);
+    }
+
+    // Returns the account only if it is already loaded.
+    static std::shared_ptr<Account> peek(EntityId accountId) {
+        Registry& r = registry();
+        std::lock_guard<std::mutex> lock(r.mutex);
+        auto it = r.byId.find(accountId);
+        return it != r.byId.end() ? it->second->account : nullptr;
+    }
+
+    static void setMemoryBudget(size_t bytes) {
+        Registry& r = registry();
+        std::vector<Eviction> evictions;
+        {
+            std::lock_guard<std::mutex> lock(r.mutex);
+            r.memoryBudget = bytes;
+            evictions = trim(r);
+        }
+        finishEvictions(r, evictions);
+    }
+
+    static Stats getStats() {
+        Registry& r = registry();
+        std::lock_guard<std::mutex> lock(r.mutex);
+        Stats stats = r.stats;
+        stats.residentAccounts = r.entries.size();
+        stats.residentBytes = 0;
+        for (const auto& entry : r.entries) {
+            stats.residentBytes += entry.account->estimateMemoryUsage();
+        }
+        stats.memoryBudget = r.memoryBudget;
+        return stats;
+    }
+};
+
+// Entry in a user's account directory. The account itself lives in the
+// AccountCache and is loaded only when it is opened.
+class AccountHandle {
+private:
+    EntityId accountId;
+    std::string name;
+
+public:
+    AccountHandle(EntityId id, const std::string& accountName)
+        : accountId(id), name(accountName) {}
+
+    EntityId getId() const { return accountId; }
+    const std::string& getName() const { return name; }
+
+    bool isLoaded() const {
+        return AccountCache::peek(accountId) != nullptr;
+    }
+
+    double getBalance() const {
+        std::shared_ptr<Account> account = AccountCache::peek(accountId);
+        return account ? account->getBalance() : Account::readInfo(accountId).balance;
+    }
+
+    std::shared_ptr<Account> open() {
+        return AccountCache::get(accountId);
+    }
+};
+
+class User : public BaseEntity {
+private:
+    std::string username;
+    std::string passwordHash;
+
+    // Account directory, persisted as "accountId,name" lines in
+    // data/users/accounts_<userId>.txt and read on first use. Guarded by
+    // accountsMutex, since several sessions may share one user.
+    std::vector<AccountHandle> accounts;
+    bool accountsLoaded = false;
+    std::mutex accountsMutex;
+
+    std::string accountsFile() const {
+        return "data/users/accounts_" + std::to_string(id) + ".txt";
+    }
+
+    // Caller holds accountsMutex.
+    void loadAccounts() {
+        if (accountsLoaded) {
+            return;
+        }
+        MappedFile file(accountsFile());
+        MappedFile::forEachLine(file.view(), [this](std::string_view line) {
+            size_t comma = line.find(',');
+            EntityId accountId;
+            if (comma != std::string_view::npos && parseNumber(line.substr(0, comma), accountId)) {
+                accounts.emplace_back(accountId, std::string(line.substr(comma + 1)));
+            }
+        });
+        accountsLoaded = true;
+    }
+
+
+public:
+    User(const std::string& name, const std::string& password)
+        : BaseEntity(), username(name) {
+        passwordHash = SimpleEncryption::encrypt(password, "FINANCE_APP_SALT");
+    }
+
+    // Restores a stored user; the hash is taken as-is.
+    User(std::string_view name, std::string_view storedHash, EntityId userId, time_t created, time_t updated)
+        : BaseEntity(userId, created, updated), username(name), passwordHash(storedHash) {}
+
+    std::string serialize() const {
+        std::stringstream ss;
+        ss << username << "," << passwordHash << "," << id << "," << createdAt << "," << updatedAt;
+        return ss.str();
+    }
+
+    // The username is read from the left and the id and timestamps from the
+    // right; the stored hash is whatever lies between them.
+    static std::unique_ptr<User> deserialize(std::string_view data) {
+        size_t comma = data.find(',');
+        if (comma == std::string_view::npos) {
+            throw std::runtime_error("Invalid user data format");
+        }
+        std::string_view name = data.substr(0, comma);
+        std::string_view rest = data.substr(comma + 1);
+
+        std::string_view fields[3];
+        for (int i = 2; i >= 0; --i) {
+            comma = rest.rfind(',');
+            if (comma == std::string_view::npos) {
+                throw std::runtime_error("Invalid user data format");
+            }
+            fields[i] = rest.substr(comma + 1);
+            rest.remove_suffix(rest.size() - comma);
+        }
+
+        EntityId userId;
+        long long created, updated;
+        if (!parseNumber(fields[0], userId) || !parseNumber(fields[1], created) ||
+            !parseNumber(fields[2], updated)) {
+            throw std::runtime_error("Invalid user data format");
+        }
+        return std::make_unique<User>(name, rest, userId, static_cast<time_t>(created), static_cast<time_t>(updated));
+    }
+
+    bool validatePassword(const std::string& inputPassword) {
+        return SimpleEncryption::encrypt(inputPassword, "FINANCE_APP_SALT") == passwordHash;
+    }
+
+    void addAccount(std::shared_ptr<Account> account) {
+        std::lock_guard<std::mutex> lock(accountsMutex);
+        loadAccounts();
+        FileManager::appendToFile(accountsFile(),
+                                  std::to_string(account->getId()) + "," + account->getName() + "\n");
+        accounts.emplace_back(account->getId(), account->getName());
+        AccountCache::put(account);
+        updateTimestamp();
+    }
+
+    std::vector<AccountHandle> getAccounts() {
+        std::lock_guard<std::mutex> lock(accountsMutex);
+        loadAccounts();
+        return accounts;
+    }
+
+    std::shared_ptr<Account> openAccount(size_t index) {
+        AccountHandle handle = getAccounts().at(index);
+        return handle.open();
+    }
+
+    std::string getUsername() const {
+        return username;
+    }
+};
+
+// Fixed-size thread pool with work stealing. Every worker owns a deque: it
+// pops its own work LIFO and, when that is empty, steals FIFO from the others.
+// Tasks submitted from outside the pool are spread round-robin. wait() blocks
+// until every submitted task has finished and rethrows the first exception a
+// task threw.
+class ThreadPool {
+private:
+    struct WorkQueue {
+        std::mutex mutex;
+        std::deque<std::function<void()>> tasks;
+    };
+
+    std::vector<std::unique_ptr<WorkQueue>> queues;
+    std::vector<std::thread> workers;
+    std::mutex stateMutex;
+    std::condition_variable workAvailable;
+    std::condition_variable allDone;
+    size_t queued = 0;
+    size_t unfinished = 0;
+    bool stopping = false;
+    std::exception_ptr firstError;
+    std::atomic<size_t> nextQueue{0};
+
+    // Index of the pool worker running on this thread, or -1.
+    static int& currentWorker() {
+        thread_local int index = -1;
+        return index;
+    }
+
+    bool takeTask(size_t self, std::function<void()>& task) {
+        for (size_t offset = 0; offset < queues.size(); ++offset) {
+            WorkQueue& queue = *queues[(self + offset) % queues.size()];
+            std::lock_guard<std::mutex> lock(queue.mutex);
+            if (queue.tasks.empty()) {
+                continue;
+            }
+            if (offset == 0) {
+                task = std::move(queue.tasks.back());
+                queue.tasks.pop_back();
+            } else {
+                task = std::move(queue.tasks.front());
+                queue.tasks.pop_front();
+            }
+            return true;
+        }
+        return false;
+    }
+
+    void runWorker(size_t self) {
+        currentWorker() = static_cast<int>(self);
+        while (true) {
+            {
+                std::unique_lock<std::mutex> lock(stateMutex);
+                workAvailable.wait(lock, [this] { return stopping || queued > 0; });
+                if (queued == 0) {
+                    return;
+                }
+                --queued;
+            }
+            std::function<void()> task;
+            // A task is reserved above, so one is guaranteed to be found.
+            while (!takeTask(self, task)) {
+                std::this_thread::yield();
+            }
+            try {
+                task();
+            } catch (...) {
+                std::lock_guard<std::mutex> lock(stateMutex);
+                if (!firstError) {
+                    firstError = std::current_exception();
+                }
+            }
+            std::lock_guard<std::mutex> lock(stateMutex);
+            if (--unfinished == 0) {
+                allDone.notify_all();
+            }
+        }
+    }
+
+public:
+    explicit ThreadPool(size_t threadCount = std::thread::hardware_concurrency()) {
+        threadCount = std::max<size_t>(threadCount, 1);
+        for (size_t i = 0; i < threadCount; ++i) {
+            queues.push_back(std::make_unique<WorkQueue>());
+        }
+        for (size_t i = 0; i < threadCount; ++i) {
+            workers.emplace_back(&ThreadPool::runWorker, this, i);
+        }
+    }
+
+    ~ThreadPool() {
+        {
+            std::lock_guard<std::mutex> lock(stateMutex);
+            stopping = true;
+        }
+        workAvailable.notify_all();
+        for (auto& worker : workers) {
+            worker.join();
+        }
+    }
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    size_t size() const {
+        return workers.size();
+    }
+
+    void submit(std::function<void()> task) {
+        int self = currentWorker();
+        size_t target = self >= 0 ? static_cast<size_t>(self) : nextQueue++ % queues.size();
+        {
+            std::lock_guard<std::mutex> lock(queues[target]->mutex);
+            queues[target]->tasks.push_back(std::move(task));
+        }
+        {
+            std::lock_guard<std::mutex> lock(stateMutex);
+            ++queued;
+            ++unfinished;
+        }
+        workAvailable.notify_one();
+    }
+
+    void wait() {
+        std::unique_lock<std::mutex> lock(stateMutex);
+        allDone.wait(lock, [this] { return unfinished == 0; });
+        if (firstError) {
+            std::exception_ptr error = firstError;
+            firstError = nullptr;
+            std::rethrow_exception(error);
+        }
+    }
+};
+
+// Monte Carlo savings projection. Each simulated month draws every
+// category's spending independently from the account's history of complete
+// months, so each category keeps its own distribution. Paths are split into
+// fixed blocks with one RNG stream per block, which makes results depend only
+// on the seed and not on the number of threads. Balances are stored per month
+// as floats relative to the starting balance, and each month's distribution
+// is reduced to the requested percentile bands. Those balances take
+// months * paths floats, which MAX_RESULTS bounds.
+class SavingsSimulator {
+public:
+    static const int CATEGORY_COUNT = TransactionColumns::CATEGORY_COUNT;
+    static const int MAX_MONTHS = 1200;
+    static const size_t MAX_PATHS = 1000000;
+    static const size_t MAX_RESULTS = 64 * 1024 * 1024;  // 256 MB of balances
+
+    struct Scenario {
+        double monthlyContribution = 0.0;
+        int months = 12;
+        size_t paths = 10000;
+        uint64_t seed = 1;
+        // Multiplies each category's sampled spending, e.g. 0.9 for a 10% cut.
+        std::array<double, CATEGORY_COUNT> categoryScale;
+        std::vector<double> percentiles = {10, 50, 90};
+
+        Scenario() { categoryScale.fill(1.0); }
+    };
+
+    struct Projection {
+        double startingBalance = 0.0;
+        std::vector<double> percentiles;
+        std::vector<std::vector<double>> bands;  // bands[month][i] for percentiles[i]
+        double shortfallProbability = 0.0;       // share of paths below zero at the end
+        size_t historyMonths = 0;
+    };
+
+private:
+    static const size_t BLOCK_PATHS = 4096;
+
+    // xoshiro256** seeded through splitmix64.
+    class Random {
+    private:
+        uint64_t state[4];
+
+        static uint64_t rotl(uint64_t x, int k) {
+            return (x << k) | (x >> (64 - k));
+        }
+
+    public:
+        Random(uint64_t seed, uint64_t stream) {
+            uint64_t x = seed ^ (stream * 0x9E3779B97F4A7C15ULL);
+            for (auto& word : state) {
+                x += 0x9E3779B97F4A7C15ULL;
+                uint64_t z = x;
+                z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+                z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+                word = z ^ (z >> 31);
+            }
+        }
+
+        uint64_t next() {
+            uint64_t result = rotl(state[1] * 5, 7) * 9;
+            uint64_t t = state[1] << 17;
+            state[2] ^= state[0];
+            state[3] ^= state[1];
+            state[1] ^= state[2];
+            state[0] ^= state[3];
+            state[2] ^= t;
+            state[3] = rotl(state[3], 45);
+            return result;
+        }
+
+        // Uniform in [0, n) for n < 2^32, by multiply-shift.
+        static uint32_t bounded(uint32_t random, uint32_t n) {
+            return static_cast<uint32_t>((static_cast<uint64_t>(random) * n) >> 32);
+        }
+    };
+
+    // Spending history of one category; categories that never occur are
+    // left out of the simulation.
+    struct CategoryHistory {
+        std::vector<double> months;
+        double scale;
+    };
+
+    ThreadPool& pool;
+
+    // Complete months from the first month with spending up to last month,
+    // with gaps counted as months without spending. When there is no complete
+    // month yet, the current month is used as it is.
+    static std::vector<CategoryHistory> readHistory(const AccountSnapshot& snapshot, const Scenario& scenario,
+                                                    size_t& historyMonths) {
+        int current = DateUtils::currentMonth().key;
+        int first = current;
+        for (const auto& entry : snapshot.monthlySpending) {
+            first = std::min(first, entry.first);
+        }
+        int last = first < current ? current - 1 : current;
+
+        std::vector<CategoryHistory> history;
+        historyMonths = static_cast<size_t>(last - first + 1);
+        for (int c = 0; c < CATEGORY_COUNT; ++c) {
+            CategoryHistory category{std::vector<double>(historyMonths, 0.0), scenario.categoryScale[c]};
+            bool seen = false;
+            for (int key = first; key <= last; ++key) {
+                auto it = snapshot.monthlySpending.find(key);
+                if (it != snapshot.monthlySpending.end() && it->second[c] != 0.0) {
+                    category.months[key - first] = it->second[c];
+                    seen = true;
+                }
+            }
+            if (seen) {
+                history.push_back(std::move(category));
+            }
+        }
+        return history;
+    }
+
+    static void simulateBlock(const std::vector<CategoryHistory>& history, const Scenario& scenario, size_t block,
+                              size_t firstPath, size_t pathCount, size_t totalPaths, std::vector<float>& results) {
+        Random random(scenario.seed, block);
+        const uint32_t historyMonths = static_cast<uint32_t>(history.empty() ? 1 : history[0].months.size());
+        std::vector<double> savings(pathCount, 0.0);
+        for (int month = 0; month < scenario.months; ++month) {
+            float* row = results.data() + static_cast<size_t>(month) * totalPaths + firstPath;
+            for (size_t p = 0; p < pathCount; ++p) {
+                double spending = 0.0;
+                for (size_t c = 0; c < history.size(); c += 2) {
+                    uint64_t bits = random.next();
+                    uint32_t index = Random::bounded(static_cast<uint32_t>(bits), historyMonths);
+                    spending += history[c].months[index] * history[c].scale;
+                    if (c + 1 < history.size()) {
+                        index = Random::bounded(static_cast<uint32_t>(bits >> 32), historyMonths);
+                        spending += history[c + 1].months[index] * history[c + 1].scale;
+                    }
+                }
+                savings[p] += scenario.monthlyContribution - spending;
+                row[p] = static_cast<float>(savings[p]);
+            }
+        }
+    }
+
+public:
+    explicit SavingsSimulator(ThreadPool& threadPool) : pool(threadPool) {}
+
+    static void validate(const Scenario& scenario) {
+        if (scenario.months <= 0 || scenario.paths == 0) {
+            throw std::runtime_error("Projection needs at least one month and one path");
+        }
+        if (scenario.months > MAX_MONTHS) {
+            throw std::runtime_error("Projection is limited to " + std::to_string(MAX_MONTHS) + " months");
+        }
+        if (scenario.paths > MAX_PATHS) {
+            throw std::runtime_error("Projection is limited to " + std::to_string(MAX_PATHS) + " paths");
+        }
+        if (static_cast<size_t>(scenario.months) * scenario.paths > MAX_RESULTS) {
+            throw std::runtime_error("Projection is limited to " + std::to_string(MAX_RESULTS) +
+                                     " months x paths; use fewer paths for long horizons");
+        }
+    }
+
+    Projection project(const AccountSnapshot& snapshot, const Scenario& scenario) {
+        validate(scenario);
+        Projection projection;
+        projection.startingBalance = snapshot.balance;
+        projection.percentiles = scenario.percentiles;
+        std::vector<CategoryHistory> history = readHistory(snapshot, scenario, projection.historyMonths);
+
+        const size_t paths = scenario.paths;
+        const size_t months = static_cast<size_t>(scenario.months);
+        std::vector<float> results(months * paths);
+        for (size_t block = 0; block * BLOCK_PATHS < paths; ++block) {
+            size_t firstPath = block * BLOCK_PATHS;
+            size_t count = std::min(BLOCK_PATHS, paths - firstPath);
+            pool.submit([&history, &scenario, &results, block, firstPath, count, paths] {
+                simulateBlock(history, scenario, block, firstPath, count, paths, results);
+            });
+        }
+        pool.wait();
+
+        projection.bands.assign(months, std::vector<double>(scenario.percentiles.size()));
+        std::vector<size_t> order(scenario.percentiles.size());
+        for (size_t i = 0; i < order.size(); ++i) {
+            order[i] = i;
+        }
+        std::sort(order.begin(), order.end(), [&scenario](size_t a, size_t b) {
+            return scenario.percentiles[a] < scenario.percentiles[b];
+        });
+        for (size_t month = 0; month < months; ++month) {
+            pool.submit([&projection, &scenario, &results, &order, month, paths] {
+                float* row = results.data() + month * paths;
+                // Ascending percentiles, so each selection only searches the
+                // part of the row above the previous one.
+                float* begin = row;
+                for (size_t i : order) {
+                    double rank = std::clamp(scenario.percentiles[i], 0.0, 100.0) / 100.0 * (paths - 1);
+                    float* nth = row + static_cast<size_t>(rank + 0.5);
+                    std::nth_element(begin, nth, row + paths);
+                    projection.bands[month][i] = projection.startingBalance + *nth;
+                    begin = nth;
+                }
+            });
+        }
+        pool.wait();
+
+        const float* last = results.data() + (months - 1) * paths;
+        float threshold = static_cast<float>(-projection.startingBalance);
+        projection.shortfallProbability =
+            static_cast<double>(std::count_if(last, last + paths, [threshold](float v) { return v < threshold; })) /
+            static_cast<double>(paths);
+        return projection;
+    }
+
+    static void writeProjection(std::ostream& out, const Projection& projection, double monthlyContribution) {
+        out << "\n=== Savings Projection Range ===" << std::endl;
+        out << "Starting Balance: $" << std::fixed << std::setprecision(2) << projection.startingBalance << std::endl;
+        out << "Monthly Contribution: $" << monthlyContribution << std::endl;
+        out << "Spending history: " << projection.historyMonths << " month(s)" << std::endl;
+
+        out << "\nMonth";
+        for (double percentile : projection.percentiles) {
+            out << "\tP" << std::setprecision(0) << percentile;
+        }
+        out << std::setprecision(2) << std::endl;
+        for (size_t month = 0; month < projection.bands.size(); ++month) {
+            out << month + 1;
+            for (double balance : projection.bands[month]) {
+                out << "\t$" << balance;
+            }
+            out << std::endl;
+        }
+        out << "\nChance of a negative balance at the end: " << projection.shortfallProbability * 100 << "%"
+            << std::endl;
+    }
+};
+
+class FinancialPlanner : public BaseEntity {
+private:
+    Account& account;
+
+public:
+    FinancialPlanner(Account& acc) 
+        : BaseEntity(), account(acc) {}
+
+    void projectSavings(double monthlyContribution, int months) {
+        double currentBalance = account.getBalance();
+        double projectedBalance = currentBalance;
+        double totalMonthlySpending = account.getTotalMonthlySpending();
+
+        std::cout << "\n=== Savings Projection ===" << std::endl;
+        std::cout << "Starting Balance: $" << std::fixed << std::setprecision(2) << currentBalance << std::endl;
+        std::cout << "Monthly Contribution: $" << monthlyContribution << std::endl;
+        std::cout << "Projected Monthly Spending: $" << totalMonthlySpending << std::endl;
+
+        std::cout << "\nMonth\tProjected Balance\tNet Savings" << std::endl;
+        for (int month = 1; month <= months; ++month) {
+            projectedBalance += monthlyContribution - totalMonthlySpending;
+            double netSavings = projectedBalance - currentBalance;
+            
+            std::cout << month << "\t$" 
+                      << projectedBalance << "\t\t$" 
+                      << netSavings << std::endl;
+        }
+    }
+
+    // Percentile bands of the balance, simulated from the spending history.
+    void projectSavingsRange(double monthlyContribution, int months, size_t paths) {
+        SavingsSimulator::Scenario scenario;
+        scenario.monthlyContribution = monthlyContribution;
+        scenario.months = months;
+        scenario.paths = paths;
+        ThreadPool pool;
+        SavingsSimulator simulator(pool);
+        SavingsSimulator::Projection projection = simulator.project(*account.snapshot(), scenario);
+        SavingsSimulator::writeProjection(std::cout, projection, monthlyContribution);
+    }
+
+    void provideSpendingInsights() {
+        writeSpendingInsights(std::cout, account.getCategorySpending());
+    }
+
+    static void writeSpendingInsights(std::ostream& out, const std::map<SpendingCategory, double>& categorySpending) {
+        out << "\n=== Spending Insights ===" << std::endl;
+        
+        double totalSpending = 0.0;
+        for (const auto& [category, amount] : categorySpending) {
+            totalSpending += amount;
+        }
+
+        out << "Total Spending Analysis:" << std::endl;
+        for (const auto& [category, amount] : categorySpending) {
+            double percentage = (amount / totalSpending) * 100.0;
+            out << getCategoryString(category) << ": $" 
+                << amount << " (" << std::fixed << std::setprecision(2) 
+                << percentage << "%)" << std::endl;
+        }
+
+        out << "\nRecommendations:" << std::endl;
+        for (const auto& [category, amount] : categorySpending) {
+            double percentage = (amount / totalSpending) * 100.0;
+            if (percentage > 30.0) {
+                out << "- High spending in " << getCategoryString(category) 
+                    << ". Consider reducing expenses." << std::endl;
+            }
+        }
+    }
+};
+
+// Generates month-end reports for many accounts at once. Every account's
+// columns are cut into fixed-size chunks and the chunks of all accounts are
+// aggregated in parallel on a ThreadPool. Partial sums are merged per account
+// in chunk order, so the totals do not depend on scheduling. Each report
+// (financial report plus spending insights) is written to
+// <outputDir>/report_<accountId>.txt.
+//
+// Each account is reported from one snapshot, so writers may keep modifying
+// the accounts while a batch is running.
+class ReportEngine {
+private:
+    // Column blocks per task, about 256k rows.
+    static const size_t CHUNK_BLOCKS = (1 << 18) / SharedChunks<double>::CHUNK;
+
+    using CategoryTotals = TransactionColumns::CategoryTotals;
+
+    struct Partial {
+        CategoryTotals allTime{};
+        CategoryTotals inMonth{};
+        uint32_t present = 0;  // bit c: category c occurs in the chunk
+    };
+
+    ThreadPool& pool;
+
+public:
+    explicit ReportEngine(ThreadPool& threadPool) : pool(threadPool) {}
+
+    // Reports on `month` (defaults to the current month). Returns the paths
+    // written, in the same order as `accounts`.
+    std::vector<std::string> generate(const std::vector<std::shared_ptr<Account>>& accounts,
+                                      const std::string& outputDir,
+                                      DateUtils::MonthRange month = DateUtils::currentMonth()) {
+        FileManager::createDirectory(outputDir);
+
+        std::vector<std::shared_ptr<const AccountSnapshot>> snapshots(accounts.size());
+        std::vector<std::vector<Partial>> partials(accounts.size());
+        for (size_t a = 0; a < accounts.size(); ++a) {
+            accounts[a]->refresh();
+            snapshots[a] = accounts[a]->snapshot();
+            const TransactionColumns& columns = snapshots[a]->columns;
+            size_t chunks = (columns.blockCount() + CHUNK_BLOCKS - 1) / CHUNK_BLOCKS;
+            partials[a].resize(chunks);
+            for (size_t c = 0; c < chunks; ++c) {
+                Partial* out = &partials[a][c];
+                pool.submit([&columns, out, c, month] {
+                    size_t last = std::min(columns.blockCount(), (c + 1) * CHUNK_BLOCKS);
+                    for (size_t b = c * CHUNK_BLOCKS; b < last; ++b) {
+                        TransactionColumns::Block rows = columns.block(b);
+                        CategoryTotals allTime, inMonth;
+                        SpendingKernels::sumByCategory(rows.amounts, rows.categories, rows.rows, allTime.data());
+                        SpendingKernels::sumByCategoryInRange(rows.amounts, rows.categories, rows.dates, rows.rows,
+                                                              month.start, month.end, inMonth.data());
+                        for (int k = 0; k < TransactionColumns::CATEGORY_COUNT; ++k) {
+                            out->allTime[k] += allTime[k];
+                            out->inMonth[k] += inMonth[k];
+                        }
+                        for (size_t i = 0; i < rows.rows; ++i) {
+                            if (rows.categories[i] < TransactionColumns::CATEGORY_COUNT) {
+                                out->present |= 1u << rows.categories[i];
+                            }
+                        }
+                    }
+                });
+            }
+        }
+        pool.wait();
+
+        std::vector<std::string> paths(accounts.size());
+        for (size_t a = 0; a < accounts.size(); ++a) {
+            paths[a] = outputDir + "/report_" + std::to_string(accounts[a]->getId()) + ".txt";
+            pool.submit([&snapshots, &partials, &paths, a] {
+                writeReport(*snapshots[a], partials[a], paths[a]);
+            });
+        }
+        pool.wait();
+        return paths;
+    }
+
+private:
+    static void writeReport(const AccountSnapshot& account, const std::vector<Partial>& partials, const std::string& path) {
+        CategoryTotals allTime{};
+        CategoryTotals inMonth{};
+        uint32_t present = 0;
+        for (const auto& partial : partials) {
+            present |= partial.present;
+            for (int c = 0; c < TransactionColumns::CATEGORY_COUNT; ++c) {
+                allTime[c] += partial.allTime[c];
+                inMonth[c] += partial.inMonth[c];
+            }
+        }
+
+        // A category is listed when it occurs in the account, as in printFinancialReport.
+        std::map<SpendingCategory, double> categorySpending;
+        for (int c = 0; c < TransactionColumns::CATEGORY_COUNT; ++c) {
+            if (present & (1u << c)) {
+                categorySpending[static_cast<SpendingCategory>(c)] = allTime[c];
+            }
+        }
+        double monthlySpending = 0.0;
+        for (double amount : inMonth) {
+            monthlySpending += amount;
+        }
+
+        std::stringstream report;
+        account.writeFinancialReport(report, categorySpending, monthlySpending);
+        FinancialPlanner::writeSpendingInsights(report, categorySpending);
+        FileManager::saveToFile(path, report.str());
+    }
+};
+
+// Streams transactions from a CSV export into an account. One thread reads
+// the input in chunks of whole lines, the chunks are parsed, validated and
+// categorized on a ThreadPool, and the calling thread commits the rows in
+// input order, in batches, through Account::addTransactions. Ids are
+// assigned at commit, so they follow file order.
+//
+// The first line must be a header naming at least a date and an amount
+// column; category and description/memo/payee columns are optional. When the
+// category is missing or unknown it is guessed from whole-word keywords in the
+// category and description text. Fields may be quoted, but not span lines.
+//
+// The pipeline holds at most about memoryLimit bytes of input, parsed rows and
+// pending batch, whatever the size of the input: a quarter goes to the batch,
+// which is committed once its rows reach that estimate or batchRows, and the
+// rest to chunks being read and parsed. Rows that fail validation are counted
+// and the first few are reported with line numbers.
+class TransactionImporter {
+public:
+    struct Progress {
+        uint64_t bytesRead = 0;
+        uint64_t rowsImported = 0;
+        uint64_t rowsRejected = 0;
+        double elapsedSeconds = 0.0;
+        double rowsPerSecond = 0.0;
+        bool finished = false;
+        std::vector<std::string> errors;  // the first MAX_ERRORS rejections
+    };
+
+    struct Options {
+        size_t memoryLimit = 64 * 1024 * 1024;
+        size_t batchRows = 100000;
+        // Card exports often sign purchases negative; import them as spending.
+        bool debitsNegative = false;
+        std::chrono::milliseconds progressInterval{1000};
+        std::function<void(const Progress&)> onProgress;
+    };
+
+    static const size_t MAX_ERRORS = 20;
+
+private:
+    struct Columns {
+        int date = -1;
+        int amount = -1;
+        int category = -1;
+        int description = -1;
+        int count = 0;
+    };
+
+    struct Chunk {
+        uint64_t firstLine;
+        std::string text;
+    };
+
+    // A validated row, waiting for its id.
+    struct ParsedRow {
+        double amount;
+        SpendingCategory category;
+        std::string description;
+        time_t date;
+    };
+
+    struct ParsedChunk {
+        std::vector<ParsedRow> rows;
+        uint64_t rejected = 0;
+        std::vector<std::string> errors;
+        std::exception_ptr failure;
+    };
+
+    ThreadPool& pool;
+    Options options;
+
+    // Splits one CSV line into fields, unquoting "..." and "" escapes.
+    static void splitLine(std::string_view line, std::vector<std::string>& fields) {
+        fields.clear();
+        std::string field;
+        bool quoted = false;
+        for (size_t i = 0; i < line.size(); ++i) {
+            char c = line[i];
+            if (quoted) {
+                if (c == '"' && i + 1 < line.size() && line[i + 1] == '"') {
+                    field += '"';
+                    ++i;
+                } else if (c == '"') {
+                    quoted = false;
+                } else {
+                    field += c;
+                }
+            } else if (c == '"') {
+                quoted = true;
+            } else if (c == ',') {
+                fields.push_back(std::move(field));
+                field.clear();
+            } else if (c != '\r') {
+                field += c;
+            }
+        }
+        fields.push_back(std::move(field));
+    }
+
+    static std::string toLower(std::string_view text) {
+        std::string lower(text);
+        for (char& c : lower) {
+            c = static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+        }
+        size_t start = lower.find_first_not_of(' ');
+        size_t end = lower.find_last_not_of(' ');
+        return start == std::string::npos ? std::string() : lower.substr(start, end - start + 1);
+    }
+
+    static Columns readHeader(const std::string& header) {
+        static const std::vector<std::pair<std::string, int Columns::*>> aliases = {
+            {"date", &Columns::date}, {"transaction date", &Columns::date}, {"posted date", &Columns::date},
+            {"posting date", &Columns::date}, {"dtposted", &Columns::date},
+            {"amount", &Columns::amount}, {"trnamt", &Columns::amount},
+            {"category", &Columns::category},
+            {"description", &Columns::description}, {"memo", &Columns::description},
+            {"payee", &Columns::description}, {"name", &Columns::description},
+            {"merchant", &Columns::description},
+        };
+        std::vector<std::string> fields;
+        splitLine(header, fields);
+        Columns columns;
+        columns.count = static_cast<int>(fields.size());
+        for (size_t i = 0; i < fields.size(); ++i) {
+            std::string name = toLower(fields[i]);
+            for (const auto& [alias, column] : aliases) {
+                if (name == alias && columns.*column < 0) {
+                    columns.*column = static_cast<int>(i);
+                }
+            }
+        }
+        if (columns.date < 0 || columns.amount < 0) {
+            throw std::runtime_error("CSV header must name a date and an amount column");
+        }
+        return columns;
+    }
+
+    // Lowercases the text and turns every run of other than letters and digits
+    // into one space, with a space at each end, so " word " finds whole words.
+    static std::string words(std::string_view text) {
+        std::string padded = " ";
+        for (char c : text) {
+            if (std::isalnum(static_cast<unsigned char>(c))) {
+                padded += static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+            } else if (padded.back() != ' ') {
+                padded += ' ';
+            }
+        }
+        if (padded.back() != ' ') {
+            padded += ' ';
+        }
+        return padded;
+    }
+
+    // Category names first, then keywords common in bank and card exports,
+    // matched as whole words ("rent" does not match "parent").
+    static SpendingCategory mapCategory(const std::string& category, const std::string& description) {
+        static const std::vector<std::pair<const char*, SpendingCategory>> keywords = {
+            {"grocer", SpendingCategory::FOOD}, {"grocers", SpendingCategory::FOOD},
+            {"grocery", SpendingCategory::FOOD}, {"groceries", SpendingCategory::FOOD},
+            {"restaurant", SpendingCategory::FOOD}, {"restaurants", SpendingCategory::FOOD},
+            {"dining", SpendingCategory::FOOD}, {"cafe", SpendingCategory::FOOD},
+            {"coffee", SpendingCategory::FOOD}, {"supermarket", SpendingCategory::FOOD},
+            {"fuel", SpendingCategory::TRANSPORT}, {"gas station", SpendingCategory::TRANSPORT},
+            {"transit", SpendingCategory::TRANSPORT}, {"taxi", SpendingCategory::TRANSPORT},
+            {"uber", SpendingCategory::TRANSPORT}, {"parking", SpendingCategory::TRANSPORT},
+            {"airline", SpendingCategory::TRANSPORT}, {"airlines", SpendingCategory::TRANSPORT},
+            {"rent", SpendingCategory::HOUSING}, {"mortgage", SpendingCategory::HOUSING},
+            {"movie", SpendingCategory::ENTERTAINMENT}, {"movies", SpendingCategory::ENTERTAINMENT},
+            {"cinema", SpendingCategory::ENTERTAINMENT}, {"streaming", SpendingCategory::ENTERTAINMENT},
+            {"game", SpendingCategory::ENTERTAINMENT}, {"games", SpendingCategory::ENTERTAINMENT},
+            {"electric", SpendingCategory::UTILITIES}, {"electricity", SpendingCategory::UTILITIES},
+            {"water", SpendingCategory::UTILITIES}, {"internet", SpendingCategory::UTILITIES},
+            {"phone", SpendingCategory::UTILITIES}, {"pharmacy", SpendingCategory::HEALTHCARE},
+            {"doctor", SpendingCategory::HEALTHCARE}, {"medical", SpendingCategory::HEALTHCARE},
+            {"dental", SpendingCategory::HEALTHCARE}, {"tuition", SpendingCategory::EDUCATION},
+            {"school", SpendingCategory::EDUCATION}, {"book", SpendingCategory::EDUCATION},
+            {"books", SpendingCategory::EDUCATION}, {"course", SpendingCategory::EDUCATION},
+            {"courses", SpendingCategory::EDUCATION},
+        };
+        std::string lowerCategory = toLower(category);
+        for (int i = 0; i < TransactionColumns::CATEGORY_COUNT; ++i) {
+            SpendingCategory candidate = static_cast<SpendingCategory>(i);
+            if (lowerCategory == toLower(getCategoryString(candidate))) {
+                return candidate;
+            }
+        }
+        static const std::vector<std::pair<std::string, SpendingCategory>> needles = [] {
+            std::vector<std::pair<std::string, SpendingCategory>> padded;
+            for (const auto& [keyword, mapped] : keywords) {
+                padded.emplace_back(std::string(" ") + keyword + " ", mapped);
+            }
+            return padded;
+        }();
+        for (const std::string& text : {words(category), words(description)}) {
+            for (const auto& [needle, mapped] : needles) {
+                if (text.find(needle) != std::string::npos) {
+                    return mapped;
+                }
+            }
+        }
+        return SpendingCategory::MISCELLANEOUS;
+    }
+
+    void parseChunk(const Chunk& chunk, const Columns& columns, ParsedChunk& out) const {
+        std::vector<std::string> fields;
+        uint64_t lineNumber = chunk.firstLine;
+        auto reject = [&out, &lineNumber](const std::string& reason) {
+            ++out.rejected;
+            if (out.errors.size() < MAX_ERRORS) {
+                out.errors.push_back("line " + std::to_string(lineNumber) + ": " + reason);
+            }
+        };
+        std::string_view text = chunk.text;
+        while (!text.empty()) {
+            size_t end = std::min(text.find('\n'), text.size());
+            std::string_view line = text.substr(0, end);
+            text.remove_prefix(std::min(end + 1, text.size()));
+            ++lineNumber;
+            if (line.empty() || line == "\r") {
+                continue;
+            }
+            splitLine(line, fields);
+            if (static_cast<int>(fields.size()) < columns.count) {
+                reject("expected " + std::to_string(columns.count) + " fields");
+                continue;
+            }
+            time_t date;
+            if (!DateUtils::parseDate(fields[columns.date], date)) {
+                reject("invalid date '" + fields[columns.date] + "'");
+                continue;
+            }
+            std::string_view amountText = fields[columns.amount];
+            if (!amountText.empty() && amountText.front() == '+') {
+                amountText.remove_prefix(1);
+            }
+            double amount;
+            if (!parseNumber(amountText, amount) || !std::isfinite(amount)) {
+                reject("invalid amount '" + fields[columns.amount] + "'");
+                continue;
+            }
+            if (options.debitsNegative) {
+                amount = -amount;
+            }
+            const std::string& description = columns.description >= 0 ? fields[columns.description] : std::string();
+            const std::string& category = columns.category >= 0 ? fields[columns.category] : std::string();
+            out.rows.push_back(ParsedRow{amount, mapCategory(category, description), description, date});
+        }
+    }
+
+public:
+    explicit TransactionImporter(ThreadPool& threadPool) : pool(threadPool) {}
+
+    TransactionImporter(ThreadPool& threadPool, Options importOptions)
+        : pool(threadPool), options(std::move(importOptions)) {}
+
+    Progress importCsv(std::istream& in, Account& account) {
+        auto started = std::chrono::steady_clock::now();
+        std::string header;
+        if (!std::getline(in, header)) {
+            throw std::runtime_error("Empty import file");
+        }
+        const Columns columns = readHeader(header);
+
+        // Parsed rows take roughly three times the space of their text.
+        const size_t batchBytes = options.memoryLimit / 4;
+        const size_t chunkBytes = std::clamp<size_t>(options.memoryLimit / 32, 64 * 1024, 4 * 1024 * 1024);
+        const size_t maxInFlight = std::max<size_t>(2, (options.memoryLimit - batchBytes) / (chunkBytes * 4));
+
+        std::mutex mutex;
+        std::condition_variable changed;
+        std::map<uint64_t, ParsedChunk> completed;
+        size_t inFlight = 0;
+        uint64_t chunksRead = 0;
+        bool inputDone = false;
+        bool aborted = false;
+        std::exception_ptr readError;
+        std::atomic<uint64_t> bytesRead{header.size() + 1};
+
+        // Queues a chunk for parsing; the result is filed under its sequence number.
+        auto dispatch = [&](Chunk&& text) {
+            auto chunk = std::make_shared<Chunk>(std::move(text));
+            uint64_t sequence;
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                sequence = chunksRead++;
+                ++inFlight;
+            }
+            pool.submit([this, chunk, sequence, &columns, &mutex, &changed, &completed] {
+                ParsedChunk parsed;
+                try {
+                    parseChunk(*chunk, columns, parsed);
+                } catch (...) {
+                    parsed = ParsedChunk();
+                    parsed.failure = std::current_exception();
+                }
+                std::lock_guard<std::mutex> lock(mutex);
+                completed.emplace(sequence, std::move(parsed));
+                changed.notify_all();
+            });
+        };
+
+        std::thread reader([&] {
+            try {
+                std::string carry;
+                uint64_t lineNumber = 1;  // the header
+                std::vector<char> buffer(chunkBytes);
+                while (true) {
+                    {
+                        std::unique_lock<std::mutex> lock(mutex);
+                        changed.wait(lock, [&] { return aborted || inFlight < maxInFlight; });
+                        if (aborted) {
+                            break;
+                        }
+                    }
+                    in.read(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+                    size_t got = static_cast<size_t>(in.gcount());
+                    if (got == 0) {
+                        break;
+                    }
+                    bytesRead += got;
+                    // Hand over whole lines only; keep the partial last line.
+                    std::string text = std::move(carry);
+                    text.append(buffer.data(), got);
+                    size_t lastNewline = text.rfind('\n');
+                    if (lastNewline == std::string::npos) {
+                        carry = std::move(text);
+                        continue;
+                    }
+                    carry = text.substr(lastNewline + 1);
+                    text.resize(lastNewline + 1);
+
+                    uint64_t lines = std::count(text.begin(), text.end(), '\n');
+                    dispatch(Chunk{lineNumber, std::move(text)});
+                    lineNumber += lines;
+                }
+                if (!carry.empty()) {
+                    dispatch(Chunk{lineNumber, std::move(carry)});
+                }
+            } catch (...) {
+                std::lock_guard<std::mutex> lock(mutex);
+                readError = std::current_exception();
+            }
+            std::lock_guard<std::mutex> lock(mutex);
+            inputDone = true;
+            changed.notify_all();
+        });
+
+        Progress progress;
+        auto lastReport = started;
+        auto report = [&](bool finished) {
+            auto now = std::chrono::steady_clock::now();
+            progress.bytesRead = bytesRead.load();
+            progress.elapsedSeconds = std::chrono::duration<double>(now - started).count();
+            progress.rowsPerSecond = progress.elapsedSeconds > 0
+                                         ? (progress.rowsImported + progress.rowsRejected) / progress.elapsedSeconds
+                                         : 0.0;
+            progress.finished = finished;
+            lastReport = now;
+            if (options.onProgress) {
+                options.onProgress(progress);
+            }
+        };
+
+        std::vector<Transaction> batch;
+        size_t pendingBytes = 0;  // estimated: each row plus its own copy of the description
+        try {
+            uint64_t nextSequence = 0;
+            while (true) {
+                ParsedChunk parsed;
+                {
+                    std::unique_lock<std::mutex> lock(mutex);
+                    changed.wait(lock, [&] {
+                        return completed.count(nextSequence) || (inputDone && nextSequence == chunksRead);
+                    });
+                    auto it = completed.find(nextSequence);
+                    if (it == completed.end()) {
+                        break;
+                    }
+                    parsed = std::move(it->second);
+                    completed.erase(it);
+                    --inFlight;
+                    ++nextSequence;
+                }
+                changed.notify_all();
+                if (parsed.failure) {
+                    std::rethrow_exception(parsed.failure);
+                }
+
+                progress.rowsRejected += parsed.rejected;
+                for (auto& error : parsed.errors) {
+                    if (progress.errors.size() < MAX_ERRORS) {
+                        progress.errors.push_back(std::move(error));
+                    }
+                }
+                time_t now = std::time(nullptr);
+                for (const ParsedRow& row : parsed.rows) {
+                    batch.emplace_back(IdGenerator::next(), row.amount, row.category, row.description, row.date,
+                                       now, now);
+                    pendingBytes += sizeof(Transaction) + row.description.size();
+                    if (batch.size() >= options.batchRows || pendingBytes >= batchBytes) {
+                        account.addTransactions(batch);
+                        progress.rowsImported += batch.size();
+                        batch.clear();
+                        pendingBytes = 0;
+                    }
+                }
+                if (std::chrono::steady_clock::now() - lastReport >= options.progressInterval) {
+                    report(false);
+                }
+            }
+            account.addTransactions(batch);
+            progress.rowsImported += batch.size();
+        } catch (...) {
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                aborted = true;
+            }
+            changed.notify_all();
+            reader.join();
+            pool.wait();
+            throw;
+        }
+        reader.join();
+        pool.wait();
+        if (readError) {
+            std::rethrow_exception(readError);
+        }
+        report(true);
+        return progress;
+    }
+};
+
+// Users are stored in SHARD_COUNT append-only files, data/users/users_<n>.txt,
+// partitioned by a stable hash of the username. Each shard has an index file,
+// users_<n>.idx, of "username,offset" lines pointing into the shard. Nothing is
+// read at startup: the first lookup touching a shard loads its index, and a
+// user's record is parsed only when that user logs in.
+class UserManager : public BaseEntity {
+private:
+    static const size_t SHARD_COUNT = 64;
+
+    struct Shard {
+        bool loaded = false;
+        uint64_t size = 0;
+        std::unordered_map<std::string, uint64_t> offsets;
+    };
+
+    // Users are heap-allocated so User* handles (currentUser, the index)
+    // stay valid as the list grows.
+    std::vector<std::unique_ptr<User>> users;
+    std::unordered_map<std::string, User*> usersByName;
+    std::vector<Shard> shards;
+    User* currentUser;
+    std::string dataPath;
+    // Guards the shards and the loaded users; public entry points lock it.
+    std::mutex mutex;
+
+    // FNV-1a, so the partitioning does not depend on the standard library.
+    static size_t shardOf(std::string_view username) {
+        uint64_t hash = 1469598103934665603ULL;
+        for (unsigned char c : username) {
+            hash = (hash ^ c) * 1099511628211ULL;
         }
+        return static_cast<size_t>(hash % SHARD_COUNT);
     }
 
-    void setMonthlyBudget(double budget) {
-        monthlyBudget = budget;
-        updateTimestamp();
+    std::string shardFile(size_t shard) const {
+        return dataPath + "/users_" + std::to_string(shard) + ".txt";
     }
 
-    std::string getName() const { return name; }
-    double getBalance() const { return balance; }
-
-    double getMonthlyBudget() const {
-        return monthlyBudget;
+    std::string shardIndexFile(size_t shard) const {
+        return dataPath + "/users_" + std::to_string(shard) + ".idx";
     }
 
-    std::map<SpendingCategory, double> getCategorySpending() const {
-        std::map<SpendingCategory, double> categorySpending;
-        for (const auto& transaction : transactions) {
-            categorySpending[transaction.getCategory()] += transaction.getAmount();
+    Shard& loadShard(size_t shardNumber) {
+        Shard& shard = shards[shardNumber];
+        if (shard.loaded) {
+            return shard;
         }
-        return categorySpending;
+        MappedFile index(shardIndexFile(shardNumber));
+        MappedFile::forEachLine(index.view(), [&shard](std::string_view line) {
+            size_t comma = line.rfind(',');
+            uint64_t offset;
+            if (comma != std::string_view::npos && parseNumber(line.substr(comma + 1), offset)) {
+                shard.offsets[std::string(line.substr(0, comma))] = offset;
+            }
+        });
+        shard.size = MappedFile(shardFile(shardNumber)).view().size();
+        shard.loaded = true;
+        return shard;
     }
 
-    double getTotalMonthlySpending() const {
-        double total = 0.0;
-        time_t now = std::time(nullptr);
-        std::tm* nowTm = std::localtime(&now);
-        
-        for (const auto& transaction : transactions) {
-            time_t transTime = transaction.getDate();
-            std::tm* transTm = std::localtime(&transTime);
-
-            if (transTm && nowTm && 
-                transTm->tm_mon == nowTm->tm_mon && 
-                transTm->tm_year == nowTm->tm_year) {
-                total += transaction.getAmount();
-            }
-        }
-        return total;
+    User* addLoadedUser(std::unique_ptr<User> user) {
+        users.push_back(std::move(user));
+        User* handle = users.back().get();
+        usersByName.emplace(handle->getUsername(), handle);
+        return handle;
     }
 
-    bool isOverBudget() const {
-        return getTotalMonthlySpending() > monthlyBudget;
+    void storeUser(const User& user) {
+        size_t shardNumber = shardOf(user.getUsername());
+        Shard& shard = loadShard(shardNumber);
+        std::string record = user.serialize() + "\n";
+        FileManager::appendToFile(shardFile(shardNumber), record);
+        FileManager::appendToFile(shardIndexFile(shardNumber),
+                                  user.getUsername() + "," + std::to_string(shard.size) + "\n");
+        shard.offsets[user.getUsername()] = shard.size;
+        shard.size += record.size();
     }
 
-    void printFinancialReport() const {
-        std::cout << "Financial Report for " << name << std::endl;
-        std::cout << "Current Balance: $" << std::fixed << std::setprecision(2) << balance << std::endl;
-        std::cout << "Monthly Budget: $" << monthlyBudget << std::endl;
-        
-        std::cout << "\nCategory Spending and Budgets:" << std::endl;
-        auto categorySpending = getCategorySpending();
-        for (const auto& [category, amount] : categorySpending) {
-            std::cout << getCategoryString(category) << ": $" << amount;
-            
-            auto it = std::find_if(categoryBudgets.begin(), categoryBudgets.end(),
-                                 [category](const BudgetLimit& budget) {
-                                     return budget.category == category;
-                                 });
-            
-            if (it != categoryBudgets.end()) {
-                std::cout << " (Budget: $" << it->limit;
-                if (amount > it->limit) {
-                    std::cout << " - OVER BUDGET!";
-                }
-                std::cout << ")";
-            }
-            std::cout << std::endl;
+    User* findUser(const std::string& username) {
+        auto loaded = usersByName.find(username);
+        if (loaded != usersByName.end()) {
+            return loaded->second;
         }
-
-        std::cout << "\nTotal Monthly Spending: $" << getTotalMonthlySpending() << std::endl;
-        if (isOverBudget()) {
-            std::cout << "WARNING: Over Monthly Budget!" << std::endl;
+        size_t shardNumber = shardOf(username);
+        Shard& shard = loadShard(shardNumber);
+        auto it = shard.offsets.find(username);
+        if (it == shard.offsets.end()) {
+            return nullptr;
+        }
+        MappedFile file(shardFile(shardNumber));
+        std::string_view content = file.view();
+        if (it->second >= content.size()) {
+            return nullptr;
         }
+        std::string_view record = content.substr(it->second);
+        record = record.substr(0, record.find('\n'));
+        if (!record.empty() && record.back() == '\r') {
+            record.remove_suffix(1);
+        }
+        return addLoadedUser(User::deserialize(record));
     }
-};
-
-class User : public BaseEntity {
-private:
-    std::string username;
-    std::string passwordHash;
-    std::vector<Account> accounts;
 
-public:
-    User(const std::string& name, const std::string& password)
-        : BaseEntity(), username(name) {
-        passwordHash = SimpleEncryption::encrypt(password, "FINANCE_APP_SALT");
+    // One-time conversion of the old single users.txt into shards.
+    void migrateLegacyUsers() {
+        std::string legacyFile = dataPath + "/users.txt";
+        if (!std::filesystem::exists(legacyFile)) {
+            return;
+        }
+        MappedFile legacy(legacyFile);
+        FileManager::beginBatch();
+        MappedFile::forEachLine(legacy.view(), [this](std::string_view line) {
+            std::unique_ptr<User> user = User::deserialize(line);
+            if (!findUser(user->getUsername())) {
+                storeUser(*user);
+            }
+        });
+        FileManager::commitBatch();
+        std::filesystem::rename(legacyFile, legacyFile + ".migrated");
     }
 
-    std::string serialize() const {
-        std::stringstream ss;
-        ss << username << "," << passwordHash << "," << id << "," << createdAt << "," << updatedAt;
-        return ss.str();
+public:
+    UserManager() : BaseEntity(), shards(SHARD_COUNT), currentUser(nullptr) {
+        dataPath = "data/users";
+        FileManager::createDirectory(dataPath);
+        migrateLegacyUsers();
     }
 
-    static User deserialize(const std::string& data) {
-        std::stringstream ss(data);
-        std::string token;
-        std::vector<std::string> tokens;
-        
-        while (std::getline(ss, token, ',')) {
-            tokens.push_back(token);
+    bool registerUser(const std::string& username, const std::string& password) {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (findUser(username)) {
+            return false;
         }
 
-        if (tokens.size() >= 5) {
-            User user(tokens[0], "temp_password");
-            user.passwordHash = tokens[1];
-            user.id = tokens[2];
-            user.createdAt = std::stoll(tokens[3]);
-            user.updatedAt = std::stoll(tokens[4]);
-            return user;
+        // Stored before it is published, so a failed write leaves no user
+        // that only exists in memory.
+        auto user = std::make_unique<User>(username, password);
+        storeUser(*user);
+        addLoadedUser(std::move(user));
+        updateTimestamp();
+        return true;
+    }
+
+    User* authenticateUser(const std::string& username, const std::string& password) {
+        std::lock_guard<std::mutex> lock(mutex);
+        User* user = findUser(username);
+        if (user && user->validatePassword(password)) {
+            currentUser = user;
+            return currentUser;
         }
-        throw std::runtime_error("Invalid user data format");
+        return nullptr;
     }
 
-    bool validatePassword(const std::string& inputPassword) {
-        return SimpleEncryption::encrypt(inputPassword, "FINANCE_APP_SALT") == passwordHash;
+    User* getCurrentUser() {
+        return currentUser;
     }
+};
 
-    void addAccount(const Account& account) {
-        accounts.push_back(account);
-        updateTimestamp();
+// Terminal primitives for the interactive menu. On POSIX they use termios
+// and escape sequences instead of spawning a shell for every redraw.
+class Console {
+public:
+    // Reads one key without waiting for Enter and without echo.
+    static int getKey() {
+#ifdef _WIN32
+        return _getch();
+#else
+        termios original;
+        if (tcgetattr(STDIN_FILENO, &original) != 0) {
+            return std::cin.get();
+        }
+        termios raw = original;
+        raw.c_lflag &= ~(ICANON | ECHO);
+        tcsetattr(STDIN_FILENO, TCSANOW, &raw);
+        unsigned char key = 0;
+        ssize_t result = read(STDIN_FILENO, &key, 1);
+        tcsetattr(STDIN_FILENO, TCSANOW, &original);
+        return result == 1 ? key : EOF;
+#endif
     }
 
-    std::vector<Account>& getAccounts() {
-        return accounts;
+    static void clear() {
+#ifdef _WIN32
+        system("cls");
+#else
+        std::cout << "\033[2J\033[H" << std::flush;
+#endif
     }
 
-    std::string getUsername() const {
-        return username;
+    static void pause() {
+#ifdef _WIN32
+        system("pause");
+#else
+        std::cout << "Press any key to continue . . ." << std::flush;
+        getKey();
+        std::cout << std::endl;
+#endif
     }
 };
 
-class FinancialPlanner : public BaseEntity {
+// Headless request processing: one command per line in, one response per
+// command out. A response is "OK [result]" or "ERR <message>"; commands that
+// return several lines answer "OK <count>" followed by that many lines.
+//
+//   register <username> <password>       login <username> <password>
+//   logout                               quit
+//   create-account <balance> <name>      accounts
+//   select <number>                      transactions
+//   record <amount> <category> [desc]    edit <id> <amount> <category> [desc]
+//   delete <id>                          deposit <amount> [date]
+//   set-budget <category> <limit>        delete-budget <category>
+//   monthly-budget <amount>              report
+//   insights                             import <csv path>
+//   project <contribution> <months> [paths]
+//   spending <from> <to>                 net-flow <from> <to>
+//   balance-as-of <date>
+//   search <category|*> <from|*> <to|*> <words>
+//   search-stats                         (terms, postings, bytes)
+//   pool-stats                           (interned strings, bytes)
+//   storage-format [text|binary]         (converts the base file)
+//   report-all <directory>               (one report file per account)
+//   cache-stats                          (hits misses evictions accounts bytes budget)
+//
+// Dates are YYYY-MM-DD and ranges include both days. Search words ending
+// in '*' match as prefixes; '*' in place of a filter means any.
+//
+// Account numbers and categories are the numbers shown by the interactive
+// menu. A session keeps its own user and account, so several sessions can
+// share one UserManager.
+class CommandSession {
 private:
-    Account& account;
+    UserManager& userManager;
+    User* user = nullptr;
+    std::shared_ptr<Account> account;
+    bool closed = false;
+
+    // Splits off the next space-delimited token.
+    static std::string_view nextToken(std::string_view& rest) {
+        size_t start = rest.find_first_not_of(' ');
+        if (start == std::string_view::npos) {
+            rest = {};
+            return {};
+        }
+        rest.remove_prefix(start);
+        size_t end = std::min(rest.find(' '), rest.size());
+        std::string_view token = rest.substr(0, end);
+        rest.remove_prefix(end);
+        return token;
+    }
 
-public:
-    FinancialPlanner(Account& acc) 
-        : BaseEntity(), account(acc) {}
+    // The rest of the line with leading spaces removed.
+    static std::string_view remainder(std::string_view rest) {
+        size_t start = rest.find_first_not_of(' ');
+        return start == std::string_view::npos ? std::string_view() : rest.substr(start);
+    }
 
-    void projectSavings(double monthlyContribution, int months) {
-        double currentBalance = account.getBalance();
-        double projectedBalance = currentBalance;
-        double totalMonthlySpending = account.getTotalMonthlySpending();
+    template <typename T>
+    static T parseArgument(std::string_view& rest, const char* name) {
+        T value;
+        if (!parseNumber(nextToken(rest), value)) {
+            throw std::runtime_error(std::string("Invalid ") + name);
+        }
+        return value;
+    }
 
-        std::cout << "\n=== Savings Projection ===" << std::endl;
-        std::cout << "Starting Balance: $" << std::fixed << std::setprecision(2) << currentBalance << std::endl;
-        std::cout << "Monthly Contribution: $" << monthlyContribution << std::endl;
-        std::cout << "Projected Monthly Spending: $" << totalMonthlySpending << std::endl;
+    static std::string requireToken(std::string_view& rest, const char* name) {
+        std::string_view token = nextToken(rest);
+        if (token.empty()) {
+            throw std::runtime_error(std::string("Missing ") + name);
+        }
+        return std::string(token);
+    }
 
-        std::cout << "\nMonth\tProjected Balance\tNet Savings" << std::endl;
-        for (int month = 1; month <= months; ++month) {
-            projectedBalance += monthlyContribution - totalMonthlySpending;
-            double netSavings = projectedBalance - currentBalance;
-            
-            std::cout << month << "\t$" 
-                      << projectedBalance << "\t\t$" 
-                      << netSavings << std::endl;
+    static SpendingCategory parseCategory(std::string_view& rest) {
+        int category = parseArgument<int>(rest, "category");
+        if (category < 0 || category >= TransactionColumns::CATEGORY_COUNT) {
+            throw std::runtime_error("Invalid category");
         }
+        return static_cast<SpendingCategory>(category);
     }
 
-    void provideSpendingInsights() {
-        auto categorySpending = account.getCategorySpending();
-        
-        std::cout << "\n=== Spending Insights ===" << std::endl;
-        
-        double totalSpending = 0.0;
-        for (const auto& [category, amount] : categorySpending) {
-            totalSpending += amount;
+    // Consumes a "*" argument, which stands for "any".
+    static bool skipWildcard(std::string_view& rest) {
+        std::string_view lookahead = rest;
+        if (nextToken(lookahead) != "*") {
+            return false;
         }
+        rest = lookahead;
+        return true;
+    }
 
-        std::cout << "Total Spending Analysis:" << std::endl;
-        for (const auto& [category, amount] : categorySpending) {
-            double percentage = (amount / totalSpending) * 100.0;
-            std::cout << getCategoryString(category) << ": $" 
-                      << amount << " (" << std::fixed << std::setprecision(2) 
-                      << percentage << "%)" << std::endl;
+    // A calendar date, as accepted by the CSV importer, to local midnight.
+    static time_t parseDay(std::string_view& rest, const char* name) {
+        time_t day;
+        if (!DateUtils::parseDate(nextToken(rest), day)) {
+            throw std::runtime_error(std::string("Invalid ") + name);
         }
+        return DateUtils::startOfDay(day);
+    }
 
-        std::cout << "\nRecommendations:" << std::endl;
-        for (const auto& [category, amount] : categorySpending) {
-            double percentage = (amount / totalSpending) * 100.0;
-            if (percentage > 30.0) {
-                std::cout << "- High spending in " << getCategoryString(category) 
-                          << ". Consider reducing expenses." << std::endl;
-            }
+    User& requireUser() {
+        if (!user) {
+            throw std::runtime_error("Not logged in");
         }
+        return *user;
     }
-};
 
-class UserManager : public BaseEntity {
-private:
-    std::vector<User> users;
-    User* currentUser;
-    std::string dataPath;
+    Account& requireAccount() {
+        requireUser();
+        if (!account) {
+            throw std::runtime_error("No account selected");
+        }
+        return *account;
+    }
 
-    void saveUsers() {
-        std::string filename = dataPath + "/users.txt";
-        std::stringstream ss;
-        for (const auto& user : users) {
-            ss << user.serialize() << "\n";
+    // Frames multi-line text as "OK <count>" plus the lines.
+    static std::string multiline(const std::string& text) {
+        size_t count = std::count(text.begin(), text.end(), '\n');
+        if (!text.empty() && text.back() != '\n') {
+            return "OK " + std::to_string(count + 1) + "\n" + text + "\n";
         }
-        FileManager::saveToFile(filename, ss.str());
+        return "OK " + std::to_string(count) + "\n" + text;
     }
 
-    void loadUsers() {
-        std::string filename = dataPath + "/users.txt";
-        std::string content = FileManager::readFromFile(filename);
-        std::stringstream ss(content);
-        std::string line;
-        
-        users.clear();
-        while (std::getline(ss, line)) {
-            if (!line.empty()) {
-                users.push_back(User::deserialize(line));
+    std::string dispatch(std::string_view command, std::string_view args) {
+        if (command == "register") {
+            std::string username = requireToken(args, "username");
+            std::string password = requireToken(args, "password");
+            if (!userManager.registerUser(username, password)) {
+                throw std::runtime_error("Username already exists");
+            }
+            return "OK\n";
+        }
+        if (command == "login") {
+            std::string username = requireToken(args, "username");
+            std::string password = requireToken(args, "password");
+            User* authenticated = userManager.authenticateUser(username, password);
+            if (!authenticated) {
+                throw std::runtime_error("Invalid username or password");
+            }
+            user = authenticated;
+            account = nullptr;
+            return "OK\n";
+        }
+        if (command == "logout") {
+            FileManager::flush();
+            user = nullptr;
+            account = nullptr;
+            return "OK\n";
+        }
+        if (command == "quit") {
+            closed = true;
+            return "OK\n";
+        }
+        if (command == "create-account") {
+            User& owner = requireUser();
+            double balance = parseArgument<double>(args, "balance");
+            std::string name(remainder(args));
+            if (name.empty()) {
+                throw std::runtime_error("Missing name");
+            }
+            auto created = std::make_shared<Account>(name, balance);
+            owner.addAccount(created);
+            return "OK " + std::to_string(created->getId()) + "\n";
+        }
+        if (command == "accounts") {
+            std::vector<AccountHandle> accounts = requireUser().getAccounts();
+            std::string text;
+            for (size_t i = 0; i < accounts.size(); ++i) {
+                text += std::to_string(i + 1) + " " + std::to_string(accounts[i].getId()) + " " +
+                        formatNumber(accounts[i].getBalance()) + " " + accounts[i].getName() + "\n";
+            }
+            return multiline(text);
+        }
+        if (command == "select") {
+            size_t number = parseArgument<size_t>(args, "account number");
+            std::vector<AccountHandle> accounts = requireUser().getAccounts();
+            if (number == 0 || number > accounts.size()) {
+                throw std::runtime_error("Invalid account number");
+            }
+            account = accounts[number - 1].open();
+            return "OK " + std::to_string(account->getId()) + "\n";
+        }
+        if (command == "transactions") {
+            Account& selected = requireAccount();
+            selected.refresh();
+            std::shared_ptr<const AccountSnapshot> snapshot = selected.snapshot();
+            std::string text;
+            for (const auto& trans : snapshot->transactions) {
+                text += trans.serialize() + "\n";
+            }
+            return multiline(text);
+        }
+        if (command == "record") {
+            Account& selected = requireAccount();
+            double amount = parseArgument<double>(args, "amount");
+            SpendingCategory category = parseCategory(args);
+            Transaction transaction(amount, category, std::string(remainder(args)));
+            selected.addTransaction(transaction);
+            return "OK " + std::to_string(transaction.getId()) + "\n";
+        }
+        if (command == "edit") {
+            Account& selected = requireAccount();
+            EntityId transId = parseArgument<EntityId>(args, "transaction id");
+            double amount = parseArgument<double>(args, "amount");
+            SpendingCategory category = parseCategory(args);
+            selected.editTransaction(transId, amount, category, std::string(remainder(args)));
+            return "OK\n";
+        }
+        if (command == "delete") {
+            requireAccount().deleteTransaction(parseArgument<EntityId>(args, "transaction id"));
+            return "OK\n";
+        }
+        if (command == "deposit") {
+            Account& selected = requireAccount();
+            double amount = parseArgument<double>(args, "amount");
+            if (amount <= 0) {
+                throw std::runtime_error("Invalid deposit amount");
+            }
+            if (remainder(args).empty()) {
+                selected.deposit(amount);
+            } else {
+                time_t date;
+                if (!DateUtils::parseDate(nextToken(args), date)) {
+                    throw std::runtime_error("Invalid date");
+                }
+                selected.deposit(amount, date);
+            }
+            return "OK " + formatNumber(selected.getBalance()) + "\n";
+        }
+        if (command == "set-budget") {
+            Account& selected = requireAccount();
+            SpendingCategory category = parseCategory(args);
+            selected.setCategoryBudget(category, parseArgument<double>(args, "limit"));
+            return "OK\n";
+        }
+        if (command == "delete-budget") {
+            Account& selected = requireAccount();
+            selected.deleteCategoryBudget(parseCategory(args));
+            return "OK\n";
+        }
+        if (command == "monthly-budget") {
+            Account& selected = requireAccount();
+            selected.setMonthlyBudget(parseArgument<double>(args, "amount"));
+            return "OK\n";
+        }
+        if (command == "storage-format") {
+            Account& selected = requireAccount();
+            std::string_view format = nextToken(args);
+            if (format == "text") {
+                selected.setStorageFormat(StorageFormat::TEXT);
+            } else if (format == "binary") {
+                selected.setStorageFormat(StorageFormat::BINARY);
+            } else if (!format.empty()) {
+                throw std::runtime_error("Unknown storage format: " + std::string(format));
+            }
+            return selected.getStorageFormat() == StorageFormat::BINARY ? "OK binary\n" : "OK text\n";
+        }
+        if (command == "import") {
+            Account& selected = requireAccount();
+            std::string path(remainder(args));
+            std::ifstream file(path, std::ios::binary);
+            if (!file) {
+                throw std::runtime_error("Cannot open " + path);
+            }
+            ThreadPool pool;
+            TransactionImporter importer(pool);
+            TransactionImporter::Progress result = importer.importCsv(file, selected);
+            return "OK " + std::to_string(result.rowsImported) + " " + std::to_string(result.rowsRejected) + "\n";
+        }
+        if (command == "project") {
+            std::shared_ptr<const AccountSnapshot> snapshot = requireAccount().snapshot();
+            SavingsSimulator::Scenario scenario;
+            scenario.monthlyContribution = parseArgument<double>(args, "contribution");
+            scenario.months = parseArgument<int>(args, "months");
+            if (!remainder(args).empty()) {
+                scenario.paths = parseArgument<size_t>(args, "paths");
+            }
+            SavingsSimulator::validate(scenario);
+            ThreadPool pool;
+            SavingsSimulator simulator(pool);
+            std::stringstream projection;
+            SavingsSimulator::writeProjection(projection, simulator.project(*snapshot, scenario),
+                                              scenario.monthlyContribution);
+            return multiline(projection.str());
+        }
+        if (command == "report") {
+            std::shared_ptr<const AccountSnapshot> snapshot = requireAccount().snapshot();
+            std::stringstream report;
+            snapshot->writeFinancialReport(report, snapshot->getCategorySpending(),
+                                           snapshot->getTotalMonthlySpending());
+            return multiline(report.str());
+        }
+        if (command == "report-all") {
+            std::string directory(remainder(args));
+            if (directory.empty()) {
+                throw std::runtime_error("Missing directory");
+            }
+            std::vector<AccountHandle> handles = requireUser().getAccounts();
+            std::vector<std::shared_ptr<Account>> accounts;
+            for (AccountHandle& handle : handles) {
+                accounts.push_back(handle.open());
+            }
+            ThreadPool pool;
+            ReportEngine engine(pool);
+            std::string text;
+            for (const std::string& path : engine.generate(accounts, directory)) {
+                text += path + "\n";
+            }
+            return multiline(text);
+        }
+        if (command == "insights") {
+            std::shared_ptr<const AccountSnapshot> snapshot = requireAccount().snapshot();
+            std::stringstream insights;
+            FinancialPlanner::writeSpendingInsights(insights, snapshot->getCategorySpending());
+            return multiline(insights.str());
+        }
+        if (command == "balance-as-of") {
+            time_t date = parseDay(args, "date");
+            return "OK " + formatNumber(requireAccount().snapshot()->balanceAsOf(date)) + "\n";
+        }
+        if (command == "net-flow") {
+            time_t from = parseDay(args, "start date");
+            time_t to = parseDay(args, "end date");
+            return "OK " + formatNumber(requireAccount().snapshot()->netFlowBetween(from, to)) + "\n";
+        }
+        if (command == "search") {
+            // search <category|*> <from|*> <to|*> <words>
+            DescriptionIndex::Filter filter;
+            if (!skipWildcard(args)) {
+                filter.category = static_cast<int>(parseCategory(args));
+            }
+            if (!skipWildcard(args)) {
+                filter.start = parseDay(args, "start date");
+            }
+            if (!skipWildcard(args)) {
+                filter.end = DateUtils::startOfDay(parseDay(args, "end date") + 36 * 3600);
+            }
+            std::shared_ptr<const AccountSnapshot> snapshot = requireAccount().snapshot();
+            std::string text;
+            for (EntityId match : snapshot->searchTransactions(remainder(args), filter)) {
+                text += std::to_string(match) + "\n";
+            }
+            return multiline(text);
+        }
+        if (command == "search-stats") {
+            const DescriptionIndex& index = requireAccount().snapshot()->descriptionIndex;
+            return "OK " + std::to_string(index.termCount()) + " " + std::to_string(index.size()) + " " +
+                   std::to_string(index.memoryUsage()) + "\n";
+        }
+        if (command == "cache-stats") {
+            AccountCache::Stats stats = AccountCache::getStats();
+            return "OK " + std::to_string(stats.hits) + " " + std::to_string(stats.misses) + " " +
+                   std::to_string(stats.evictions) + " " + std::to_string(stats.residentAccounts) + " " +
+                   std::to_string(stats.residentBytes) + " " + std::to_string(stats.memoryBudget) + "\n";
+        }
+        if (command == "pool-stats") {
+            return "OK " + std::to_string(StringPool::size()) + " " + std::to_string(StringPool::memoryUsage()) + "\n";
+        }
+        if (command == "spending") {
+            time_t from = parseDay(args, "start date");
+            // Through the end of the last day; 36 hours is a safe step past a DST change.
+            time_t to = DateUtils::startOfDay(parseDay(args, "end date") + 36 * 3600);
+            std::shared_ptr<const AccountSnapshot> snapshot = requireAccount().snapshot();
+            TransactionDateIndex::Range range = snapshot->transactionsBetween(from, to);
+            AccountSnapshot::CategoryTotals totals = range.totalsByCategory();
+            std::stringstream spending;
+            spending << std::fixed << std::setprecision(2);
+            spending << "Transactions: " << range.size() << "\n";
+            for (int c = 0; c < AccountSnapshot::CATEGORY_COUNT; ++c) {
+                if (totals[c] != 0.0) {
+                    spending << getCategoryString(static_cast<SpendingCategory>(c)) << ": $" << totals[c] << "\n";
+                }
             }
+            return multiline(spending.str());
         }
+        throw std::runtime_error("Unknown command: " + std::string(command));
     }
 
 public:
-    UserManager() : BaseEntity(), currentUser(nullptr) {
-        dataPath = "data/users";
-        FileManager::createDirectory(dataPath);
-        loadUsers();
+    explicit CommandSession(UserManager& manager) : userManager(manager) {}
+
+    bool isClosed() const {
+        return closed;
     }
 
-    bool registerUser(const std::string& username, const std::string& password) {
-        for (const auto& user : users) {
-            if (user.getUsername() == username) {
-                return false;
-            }
+    // Executes one command line and returns its full, newline-terminated response.
+    std::string execute(std::string_view line) {
+        if (!line.empty() && line.back() == '\r') {
+            line.remove_suffix(1);
+        }
+        std::string_view args = line;
+        std::string_view command = nextToken(args);
+        if (command.empty()) {
+            return "ERR Empty command\n";
+        }
+        try {
+            return dispatch(command, args);
+        } catch (const std::exception& e) {
+            return std::string("ERR ") + e.what() + "\n";
         }
-
-        users.emplace_back(username, password);
-        updateTimestamp();
-        saveUsers();
-        return true;
     }
 
-    User* authenticateUser(const std::string& username, const std::string& password) {
-        for (auto& user : users) {
-            if (user.getUsername() == username && user.validatePassword(password)) {
-                currentUser = &user;
-                return currentUser;
+    // Runs commands until quit or end of input. Output is flushed only when no
+    // more input is buffered, so pipelined commands are answered in batches.
+    void serve(std::istream& in, std::ostream& out) {
+        std::string line;
+        while (!closed && std::getline(in, line)) {
+            out << execute(line);
+            if (in.rdbuf()->in_avail() <= 0) {
+                out.flush();
             }
         }
-        std::cout << "Invalid username or password!" << std::endl;
-        return nullptr;
-    }
-
-    User* getCurrentUser() {
-        return currentUser;
+        out.flush();
+        FileManager::flush();
     }
 };
 
@@ -616,7 +5412,7 @@ class PersonalFinanceApp : public BaseEntity {
 private:
     UserManager userManager;
     User* currentUser;
-    Account* currentAccount;
+    std::shared_ptr<Account> currentAccount;
 
     std::vector<std::string> mainMenu = {
         "Login",
@@ -636,27 +5432,39 @@ private:
         "View Financial Report",
         "Financial Planning",
         "Deposit Money",
+        "Import Transactions",
         "Logout"
     };
     
     void editTransaction() {
         if (!currentAccount) {
             std::cout << "Please select an account first." << std::endl;
-            system("pause");
+            Console::pause();
             return;
         }
 
-        // Display recent transactions
-        auto& transactions = currentAccount->getTransactions();
+        // Display recent transactions, narrowed down by a description search
+        currentAccount->refresh();
+        std::shared_ptr<const AccountSnapshot> snapshot = currentAccount->snapshot();
+        const auto& transactions = snapshot->transactions;
+        std::string query;
+        std::cout << "Search descriptions (words, 'pre*' for prefixes; empty to list all): ";
+        std::cin.ignore();
+        std::getline(std::cin, query);
+        std::vector<EntityId> matches = snapshot->searchTransactions(query);
+        std::unordered_set<EntityId> shown(matches.begin(), matches.end());
         std::cout << "Recent Transactions:" << std::endl;
         for (const auto& trans : transactions) {
+            if (!query.empty() && !shown.count(trans.getId())) {
+                continue;
+            }
             std::cout << "ID: " << trans.getId() 
                       << " Amount: $" << trans.getAmount()
                       << " Category: " << getCategoryString(trans.getCategory())
                       << " Description: " << trans.getDescription() << std::endl;
         }
 
-        std::string transId;
+        EntityId transId;
         std::cout << "Enter transaction ID to edit: ";
         std::cin >> transId;
 
@@ -686,17 +5494,19 @@ private:
         } catch (const std::exception& e) {
             std::cout << "Error: " << e.what() << std::endl;
         }
-        system("pause");
+        Console::pause();
     }
 
     void deleteTransaction() {
         if (!currentAccount) {
             std::cout << "Please select an account first." << std::endl;
-            system("pause");
+            Console::pause();
             return;
         }
 
-        auto& transactions = currentAccount->getTransactions();
+        currentAccount->refresh();
+        std::shared_ptr<const AccountSnapshot> snapshot = currentAccount->snapshot();
+        const auto& transactions = snapshot->transactions;
         std::cout << "Recent Transactions:" << std::endl;
         for (const auto& trans : transactions) {
             std::cout << "ID: " << trans.getId() 
@@ -705,7 +5515,7 @@ private:
                       << " Description: " << trans.getDescription() << std::endl;
         }
 
-        std::string transId;
+        EntityId transId;
         std::cout << "Enter transaction ID to delete: ";
         std::cin >> transId;
 
@@ -715,13 +5525,13 @@ private:
         } catch (const std::exception& e) {
             std::cout << "Error: " << e.what() << std::endl;
         }
-        system("pause");
+        Console::pause();
     }
 
     void setCategoryBudget() {
         if (!currentAccount) {
             std::cout << "Please select an account first." << std::endl;
-            system("pause");
+            Console::pause();
             return;
         }
 
@@ -745,13 +5555,13 @@ private:
         } catch (const std::exception& e) {
             std::cout << "Error: " << e.what() << std::endl;
         }
-        system("pause");
+        Console::pause();
     }
 
     void deleteCategoryBudget() {
         if (!currentAccount) {
             std::cout << "Please select an account first." << std::endl;
-            system("pause");
+            Console::pause();
             return;
         }
 
@@ -769,13 +5579,13 @@ private:
         } catch (const std::exception& e) {
             std::cout << "Error: " << e.what() << std::endl;
         }
-        system("pause");
+        Console::pause();
     }
 
     int currentSelection = 0;
 
     void displayMenu(const std::vector<std::string>& menu) {
-        system("cls");
+        Console::clear();
         std::cout << "=== Personal Finance Management ===" << std::endl
                   << "W and S to go up and down" << std::endl;
         
@@ -790,7 +5600,7 @@ private:
     }
 
     void handleKeyInput(bool isMainMenu) {
-        int key = _getch();
+        int key = Console::getKey();
         std::vector<std::string>& currentMenuRef = isMainMenu ? mainMenu : userMenu;
         
         switch (key) {
@@ -800,7 +5610,8 @@ private:
             case 's':
                 if (currentSelection < currentMenuRef.size() - 1) currentSelection++;
                 break;
-            case 13:
+            case '\r':
+            case '\n':
                 isMainMenu ? selectMainMenuItem() : selectUserMenuItem();
                 break;
         }
@@ -827,7 +5638,8 @@ private:
             case 8: viewFinancialReport(); break;
             case 9: financialPlanning(); break;
             case 10: depositMoney(); break;
-            case 11: logout(); break;
+            case 11: importTransactions(); break;
+            case 12: logout(); break;
         }
     }
 
@@ -841,8 +5653,10 @@ private:
         currentUser = userManager.authenticateUser(username, password);
         if (currentUser) {
             std::cout << "Login successful!" << std::endl;
-            system("pause");
+            Console::pause();
             currentSelection = 0;
+        } else {
+            std::cout << "Invalid username or password!" << std::endl;
         }
     }
 
@@ -854,7 +5668,7 @@ private:
         std::cin >> password;
 
         userManager.registerUser(username, password);
-        system("pause");
+        Console::pause();
     }
 
     void createAccount() {
@@ -868,22 +5682,21 @@ private:
         std::cout << "Enter initial balance: $";
         std::cin >> initialBalance;
 
-        Account newAccount(accountName, initialBalance);
-        currentUser->addAccount(newAccount);
+        currentUser->addAccount(std::make_shared<Account>(accountName, initialBalance));
 
         std::cout << "Account created successfully!" << std::endl;
-        system("pause");
+        Console::pause();
     }
 
     void selectAccount() {
         if (!currentUser || currentUser->getAccounts().empty()) {
             std::cout << "No accounts available. Create an account first." << std::endl;
-            system("pause");
+            Console::pause();
             return;
         }
 
         std::cout << "Select an account:" << std::endl;
-        auto& accounts = currentUser->getAccounts();
+        std::vector<AccountHandle> accounts = currentUser->getAccounts();
         for (size_t i = 0; i < accounts.size(); ++i) {
             std::cout << i + 1 << ". " << accounts[i].getName() << std::endl;
         }
@@ -893,35 +5706,35 @@ private:
         std::cin >> choice;
 
         if (choice > 0 && choice <= accounts.size()) {
-            currentAccount = &accounts[choice - 1];
+            currentAccount = currentUser->openAccount(choice - 1);
             std::cout << "Account selected: " << currentAccount->getName() << std::endl;
         } else {
             std::cout << "Invalid account selection." << std::endl;
         }
-        system("pause");
+        Console::pause();
     }
 
     void viewAccounts() {
         if (!currentUser || currentUser->getAccounts().empty()) {
             std::cout << "No accounts available." << std::endl;
-            system("pause");
+            Console::pause();
             return;
         }
 
         std::cout << "=== Your Accounts ===" << std::endl;
-        auto& accounts = currentUser->getAccounts();
+        std::vector<AccountHandle> accounts = currentUser->getAccounts();
         for (size_t i = 0; i < accounts.size(); ++i) {
             std::cout << "Account " << i + 1 << ": " 
                       << accounts[i].getName() 
                       << " - Balance: $" << accounts[i].getBalance() << std::endl;
         }
-        system("pause");
+        Console::pause();
     }
 
     void recordTransaction() {
         if (!currentAccount) {
             std::cout << "Please select an account first." << std::endl;
-            system("pause");
+            Console::pause();
             return;
         }
 
@@ -950,24 +5763,24 @@ private:
         currentAccount->addTransaction(transaction);
 
         std::cout << "Transaction recorded successfully!" << std::endl;
-        system("pause");
+        Console::pause();
     }
 
     void viewFinancialReport() {
         if (!currentAccount) {
             std::cout << "Please select an account first." << std::endl;
-            system("pause");
+            Console::pause();
             return;
         }
 
         currentAccount->printFinancialReport();
-        system("pause");
+        Console::pause();
     }
 
     void financialPlanning() {
         if (!currentAccount) {
             std::cout << "Please select an account first." << std::endl;
-            system("pause");
+            Console::pause();
             return;
         }
 
@@ -977,6 +5790,7 @@ private:
         std::cout << "Financial Planning Options:" << std::endl;
         std::cout << "1. Savings Projection" << std::endl;
         std::cout << "2. Spending Insights" << std::endl;
+        std::cout << "3. Savings Projection Range (Monte Carlo)" << std::endl;
         std::cout << "Enter your choice: ";
         std::cin >> choice;
 
@@ -994,16 +5808,30 @@ private:
             case 2:
                 planner.provideSpendingInsights();
                 break;
+            case 3: {
+                double monthlyContribution;
+                int months;
+                std::cout << "Enter monthly contribution: $";
+                std::cin >> monthlyContribution;
+                std::cout << "Enter projection period (months): ";
+                std::cin >> months;
+                try {
+                    planner.projectSavingsRange(monthlyContribution, months, 10000);
+                } catch (const std::exception& e) {
+                    std::cout << "Error: " << e.what() << std::endl;
+                }
+                break;
+            }
             default:
                 std::cout << "Invalid choice." << std::endl;
         }
-        system("pause");
+        Console::pause();
     }
 
     void depositMoney() {
         if (!currentAccount) {
             std::cout << "Please select an account first." << std::endl;
-            system("pause");
+            Console::pause();
             return;
         }
 
@@ -1017,15 +5845,56 @@ private:
         } else {
             std::cout << "Invalid deposit amount." << std::endl;
         }
-        system("pause");
+        Console::pause();
+    }
+
+    void importTransactions() {
+        if (!currentAccount) {
+            std::cout << "Please select an account first." << std::endl;
+            Console::pause();
+            return;
+        }
+
+        std::string path;
+        std::cout << "Enter CSV file path: ";
+        std::cin.ignore();
+        std::getline(std::cin, path);
+
+        std::ifstream file(path, std::ios::binary);
+        if (!file) {
+            std::cout << "Cannot open " << path << std::endl;
+            Console::pause();
+            return;
+        }
+
+        TransactionImporter::Options options;
+        options.onProgress = [](const TransactionImporter::Progress& progress) {
+            std::cout << "\rImported " << progress.rowsImported << " rows ("
+                      << static_cast<uint64_t>(progress.rowsPerSecond) << " rows/s)" << std::flush;
+        };
+        try {
+            ThreadPool pool;
+            TransactionImporter importer(pool, options);
+            TransactionImporter::Progress result = importer.importCsv(file, *currentAccount);
+            std::cout << std::endl << "Imported " << result.rowsImported << " transactions, rejected "
+                      << result.rowsRejected << " in " << std::fixed << std::setprecision(2)
+                      << result.elapsedSeconds << "s." << std::endl;
+            for (const auto& error : result.errors) {
+                std::cout << "  " << error << std::endl;
+            }
+        } catch (const std::exception& e) {
+            std::cout << std::endl << "Error: " << e.what() << std::endl;
+        }
+        Console::pause();
     }
 
     void logout() {
+        FileManager::flush();
         currentUser = nullptr;
         currentAccount = nullptr;
         currentSelection = 0;
         std::cout << "Logged out successfully!" << std::endl;
-        system("pause");
+        Console::pause();
     }
 
 public:
@@ -1034,6 +5903,15 @@ public:
         FileManager::createDirectory("data");
         FileManager::createDirectory("data/users");
         FileManager::createDirectory("data/accounts");
+        // Persist in the background; pending writes are flushed on logout and exit.
+        FileManager::enableWriteBehind(std::chrono::milliseconds(1000), 1000);
+    }
+
+    // Answers line protocol commands on stdin/stdout; see CommandSession.
+    void serve() {
+        std::ios::sync_with_stdio(false);
+        CommandSession session(userManager);
+        session.serve(std::cin, std::cout);
     }
 
     void run() {
@@ -1049,13 +5927,21 @@ public:
     }
 };
 
-int main() {
+// Tests and benchmarks include this file with PFM_NO_MAIN defined.
+#ifndef PFM_NO_MAIN
+int main(int argc, char* argv[]) {
     try {
+        IdGenerator::claimNodeId("data/nodes");
         PersonalFinanceApp app;
-        app.run();
+        if (argc > 1 && std::string(argv[1]) == "--serve") {
+            app.serve();
+        } else {
+            app.run();
+        }
     } catch (const std::exception& e) {
         std::cerr << "Fatal error: " << e.what() << std::endl;
         return 1;
     }
     return 0;
-}
\ No newline at end of file
+}
+#endif
@@ -0,0 +1,506 @@
+// Benchmarks. Build the finance_bench target and run "finance_bench <case>
+// [size]"; with no arguments every case runs at its default size.
+#include "../tests/harness.h"
+
+#ifndef _WIN32
+#include <sys/resource.h>
+#endif
+
+namespace {
+
+// Synthetic rows spread over five years, with descriptions drawn from a
+// few thousand repeating merchant names.
+std::vector<Transaction> syntheticRows(size_t count, uint64_t seed = 1) {
+    std::vector<Transaction> rows;
+    rows.reserve(count);
+    uint64_t state = seed;
+    auto next = [&state] {
+        state = state * 6364136223846793005ULL + 1442695040888963407ULL;
+        return state >> 33;
+    };
+    time_t start = 1600000000;
+    for (size_t i = 0; i < count; ++i) {
+        rows.emplace_back(IdGenerator::next(), 1.0 + static_cast<double>(next() % 20000) / 100.0,
+                          static_cast<SpendingCategory>(next() % TransactionColumns::CATEGORY_COUNT),
+                          "merchant " + std::to_string(next() % 3000),
+                          start + static_cast<time_t>(next() % (5 * 365 * 86400ULL)), start, start);
+    }
+    return rows;
+}
+
+}  // namespace
+
+// Cost of one journaled insert as the account grows. Each size is a fresh
+// account filled in one batch; the inserts timed are single addTransaction
+// calls, each an fsynced append (compaction is amortized over them).
+PFM_CASE(journal_append) {
+    size_t largest = harness::argument(args, 0, 1000000);
+    const int inserts = 200;
+    std::printf("%12s %14s\n", "rows", "us/append");
+    for (size_t rows = 1000; rows <= largest; rows *= 10) {
+        Account account("Bench", 0.0);
+        account.addTransactions(syntheticRows(rows));
+        double elapsed = harness::seconds([&account] {
+            for (int i = 0; i < inserts; ++i) {
+                account.addTransaction(Transaction(1.0, SpendingCategory::FOOD, "coffee"));
+            }
+        });
+        std::printf("%12zu %14.1f\n", rows, elapsed * 1e6 / inserts);
+    }
+}
+
+// Bulk insert and cold load of rows whose ids are shuffled against file
+// order, the worst case for building the description index.
+PFM_CASE(cold_load) {
+    size_t rows = harness::argument(args, 0, 200000);
+    std::vector<Transaction> batch = syntheticRows(rows);
+    std::shuffle(batch.begin(), batch.end(), std::mt19937_64(7));
+    Account account("Bench", 0.0);
+    double insert = harness::seconds([&] { account.addTransactions(batch); });
+    FileManager::flush();
+    size_t terms = 0;
+    double load = harness::seconds([&] { terms = Account(account.getId()).snapshot()->descriptionIndex.termCount(); });
+    std::printf("%zu rows: insert %.3f s, cold load %.3f s, %zu terms\n", rows, insert, load, terms);
+}
+
+// Parsing 1M serialized rows whose descriptions repeat 3000 card-statement
+// style merchant names: into Transactions, which intern the description, and
+// into rows that keep their own std::string. Bytes are the description
+// storage only: the Ref or string in each row plus the pool or heap text.
+PFM_CASE(string_interning) {
+    size_t rows = harness::argument(args, 0, 1000000);
+    std::string text;
+    for (const auto& trans : syntheticRows(rows)) {
+        Transaction row(trans.getId(), trans.getAmount(), trans.getCategory(),
+                        "POS PURCHASE " + std::string(trans.getDescription()) + " SPRINGFIELD",
+                        trans.getDate(), trans.getCreatedAt(), trans.getUpdatedAt());
+        row.appendSerialized(text);
+        text += '\n';
+    }
+
+    struct PlainRow {
+        EntityId id;
+        double amount;
+        int category;
+        std::string description;
+        long long dates[3];
+    };
+    std::vector<PlainRow> plain;
+    plain.reserve(rows);
+    double plainLoad = harness::seconds([&] {
+        MappedFile::forEachLine(text, [&plain](std::string_view line) {
+            PlainRow row;
+            std::string_view fields[6];
+            for (int i = 0; i < 3; ++i) {
+                size_t comma = line.find(',');
+                fields[i] = line.substr(0, comma);
+                line.remove_prefix(comma + 1);
+            }
+            for (int i = 5; i >= 3; --i) {
+                size_t comma = line.rfind(',');
+                fields[i] = line.substr(comma + 1);
+                line.remove_suffix(line.size() - comma);
+            }
+            CHECK(parseNumber(fields[0], row.id) && parseNumber(fields[1], row.amount) &&
+                  parseNumber(fields[2], row.category) && parseNumber(fields[3], row.dates[0]) &&
+                  parseNumber(fields[4], row.dates[1]) && parseNumber(fields[5], row.dates[2]));
+            row.description = std::string(line);
+            plain.push_back(std::move(row));
+        });
+    });
+    size_t plainBytes = 0;
+    for (const auto& row : plain) {
+        size_t capacity = row.description.capacity();
+        plainBytes += sizeof(std::string) + (capacity > std::string().capacity() ? capacity + 1 : 0);
+    }
+
+    size_t poolBefore = StringPool::memoryUsage();
+    size_t distinctBefore = StringPool::size();
+    std::vector<Transaction> interned;
+    interned.reserve(rows);
+    double internedLoad = harness::seconds([&] {
+        MappedFile::forEachLine(text, [&interned](std::string_view line) {
+            interned.push_back(Transaction::deserialize(line));
+        });
+    });
+    size_t internedBytes = rows * sizeof(StringPool::Ref) + StringPool::memoryUsage() - poolBefore;
+    CHECK(interned.size() == plain.size());
+
+    std::printf("%zu rows, %zu distinct descriptions\n", rows, StringPool::size() - distinctBefore);
+    std::printf("%-10s %12s %12s\n", "storage", "MB", "load s");
+    std::printf("%-10s %12.1f %12.3f\n", "string", plainBytes / 1e6, plainLoad);
+    std::printf("%-10s %12.1f %12.3f\n", "interned", internedBytes / 1e6, internedLoad);
+}
+
+// CSV import of 1M rows into a fresh account on a 4-thread pool, at a small
+// memory limit and the default one. Peak RSS is the process high-water mark,
+// so the smaller limit runs first.
+PFM_CASE(import) {
+    size_t rows = harness::argument(args, 0, 1000000);
+    std::string csv = "Date,Amount,Description\n";
+    for (const auto& trans : syntheticRows(rows)) {
+        std::tm date = DateUtils::toLocalTime(trans.getDate());
+        char day[16];
+        std::snprintf(day, sizeof(day), "%04d-%02d-%02d", date.tm_year + 1900, date.tm_mon + 1, date.tm_mday);
+        csv += std::string(day) + "," + formatNumber(trans.getAmount()) + ",POS " +
+               std::string(trans.getDescription()) + "\n";
+    }
+    ThreadPool pool(4);
+    std::printf("%zu rows, %.0f MB of CSV\n", rows, csv.size() / 1e6);
+    std::printf("%10s %12s %12s %14s\n", "limit MB", "seconds", "rows/s", "peak RSS MB");
+    for (size_t limit : {size_t(8) << 20, TransactionImporter::Options().memoryLimit}) {
+        Account account("Bench", 0.0);
+        TransactionImporter::Options options;
+        options.memoryLimit = limit;
+        TransactionImporter importer(pool, options);
+        std::istringstream in(csv);
+        TransactionImporter::Progress progress;
+        double elapsed = harness::seconds([&] { progress = importer.importCsv(in, account); });
+        CHECK(progress.rowsImported == rows);
+        long peak = 0;
+#ifndef _WIN32
+        rusage usage{};
+        getrusage(RUSAGE_SELF, &usage);
+        peak = usage.ru_maxrss / 1024;
+#endif
+        std::printf("%10zu %12.2f %12.0f %14ld\n", limit >> 20, elapsed, rows / elapsed, peak);
+    }
+}
+
+// Getting an account's rows for a listing: refresh() plus snapshot(), with
+// the files unchanged, and after another process appended one journal
+// record, which the next listing replays.
+PFM_CASE(listing_after_external_change) {
+    size_t largest = harness::argument(args, 0, 1000000);
+    const int listings = 1000;
+    const int changes = 5;
+    std::printf("%12s %16s %18s\n", "rows", "us/unchanged", "ms/after change");
+    for (size_t rows = 10000; rows <= largest; rows *= 10) {
+        Account account("Bench", 0.0);
+        account.addTransactions(syntheticRows(rows));
+        FileManager::flush();
+        std::string journalFile = "data/accounts/" + std::to_string(account.getId()) + "/journal_" +
+                                  std::to_string(account.getId()) + ".txt";
+        size_t listed = 0;
+        double unchanged = harness::seconds([&] {
+            for (int i = 0; i < listings; ++i) {
+                account.refresh();
+                listed += account.snapshot()->transactions.size();
+            }
+        });
+        double changed = 0.0;
+        for (int i = 0; i < changes; ++i) {
+            Transaction external(2.0, SpendingCategory::FOOD, "external");
+            std::ofstream(journalFile, std::ios::app) << "+," << external.serialize() << "\n";
+            changed += harness::seconds([&] {
+                account.refresh();
+                listed += account.snapshot()->transactions.size();
+            });
+        }
+        CHECK(account.snapshot()->transactions.size() == rows + changes);
+        std::printf("%12zu %16.2f %18.1f\n", rows, unchanged / listings * 1e6, changed / changes * 1e3);
+    }
+}
+
+// Monte Carlo projection of ten years from five years of history, by path
+// count, up to the 100k paths x 120 months the engine targets.
+PFM_CASE(savings_projection) {
+    size_t largest = harness::argument(args, 0, 100000);
+    Account account("Bench", 10000.0);
+    account.addTransactions(syntheticRows(20000));
+    auto snapshot = account.snapshot();
+    ThreadPool pool;
+    SavingsSimulator simulator(pool);
+    std::printf("%10s %8s %12s\n", "paths", "months", "seconds");
+    for (size_t paths = 1000; paths <= largest; paths *= 10) {
+        SavingsSimulator::Scenario scenario;
+        scenario.months = 120;
+        scenario.paths = paths;
+        double elapsed = harness::seconds([&] { simulator.project(*snapshot, scenario); });
+        std::printf("%10zu %8d %12.4f\n", paths, scenario.months, elapsed);
+    }
+}
+
+// Durable whole-file writes, one fsync cycle each versus group commit of
+// every dirty file at once.
+PFM_CASE(atomic_writes) {
+    size_t files = harness::argument(args, 0, 500);
+    FileManager::createDirectory("data");
+    std::string content(4096, 'x');
+    double immediate = harness::seconds([&] {
+        for (size_t i = 0; i < files; ++i) {
+            FileManager::saveToFile("data/file_" + std::to_string(i), content);
+        }
+    });
+    double grouped = harness::seconds([&] {
+        FileManager::beginBatch();
+        for (size_t i = 0; i < files; ++i) {
+            FileManager::saveToFile("data/file_" + std::to_string(i), content);
+        }
+        FileManager::commitBatch();
+    });
+    std::printf("%zu files of 4 KB: immediate %.0f writes/s, group commit %.0f writes/s\n", files,
+                files / immediate, files / grouped);
+}
+
+// Report generation for several large accounts, by worker thread count.
+PFM_CASE(report_engine) {
+    size_t rows = harness::argument(args, 0, 1000000);
+    const size_t accountCount = 4;
+    std::vector<std::shared_ptr<Account>> accounts;
+    for (size_t a = 0; a < accountCount; ++a) {
+        accounts.push_back(std::make_shared<Account>("Bench", 0.0));
+        accounts.back()->addTransactions(syntheticRows(rows, a + 1));
+    }
+    std::printf("%zu accounts x %zu rows\n%8s %10s\n", accountCount, rows, "threads", "seconds");
+    size_t hardware = std::max(1u, std::thread::hardware_concurrency());
+    for (size_t threads = 1; threads <= hardware; threads *= 2) {
+        ThreadPool pool(threads);
+        ReportEngine engine(pool);
+        engine.generate(accounts, "reports");  // warm up
+        double elapsed = harness::seconds([&] { engine.generate(accounts, "reports"); });
+        std::printf("%8zu %10.4f\n", threads, elapsed);
+    }
+}
+
+// Category totals over 100M rows: the kernels against a plain loop that
+// branches on the category and date, in random and in category order.
+PFM_CASE(spending_kernels) {
+    size_t n = harness::argument(args, 0, 100000000);
+    std::mt19937_64 random(1);
+    std::vector<double> amounts(n);
+    std::vector<uint8_t> categories(n);
+    std::vector<int64_t> dates(n);
+    for (size_t i = 0; i < n; ++i) {
+        amounts[i] = static_cast<double>(random() % 10000) / 100;
+        categories[i] = static_cast<uint8_t>(random() % SpendingKernels::LANES);
+        dates[i] = 1600000000 + static_cast<int64_t>(random() % (5 * 365 * 86400ULL));
+    }
+    const int64_t start = 1650000000, end = 1660000000;
+    double totals[SpendingKernels::LANES];
+    auto best = [](auto&& fn) {
+        double fastest = 1e9;
+        for (int run = 0; run < 5; ++run) {
+            fastest = std::min(fastest, harness::seconds(fn));
+        }
+        return fastest * 1000;
+    };
+    auto plainSum = [&] {
+        std::fill(totals, totals + SpendingKernels::LANES, 0.0);
+        for (size_t i = 0; i < n; ++i) {
+            if (categories[i] < SpendingKernels::LANES) {
+                totals[categories[i]] += amounts[i];
+            }
+        }
+    };
+    auto plainRange = [&] {
+        std::fill(totals, totals + SpendingKernels::LANES, 0.0);
+        for (size_t i = 0; i < n; ++i) {
+            if (categories[i] < SpendingKernels::LANES && dates[i] >= start && dates[i] < end) {
+                totals[categories[i]] += amounts[i];
+            }
+        }
+    };
+    auto kernelSum = [&] { SpendingKernels::sumByCategory(amounts.data(), categories.data(), n, totals); };
+    auto kernelRange = [&] {
+        SpendingKernels::sumByCategoryInRange(amounts.data(), categories.data(), dates.data(), n, start, end, totals);
+    };
+    std::printf("%zu rows, ms      plain  kernel\n", n);
+    std::printf("sum            %7.1f %7.1f\n", best(plainSum), best(kernelSum));
+    std::printf("range          %7.1f %7.1f\n", best(plainRange), best(kernelRange));
+    std::sort(categories.begin(), categories.end());
+    std::printf("sum, sorted    %7.1f %7.1f\n", best(plainSum), best(kernelSum));
+    std::printf("range, sorted  %7.1f %7.1f\n", best(plainRange), best(kernelRange));
+}
+
+// Sum by category over the row objects (AoS) and over TransactionColumns
+// (SoA), in rows per second.
+PFM_CASE(category_sum_layout) {
+    size_t rows = harness::argument(args, 0, 2000000);
+    std::vector<Transaction> transactions = syntheticRows(rows);
+    TransactionColumns columns;
+    columns.reserve(rows);
+    for (const auto& trans : transactions) {
+        columns.push(trans);
+    }
+    TransactionColumns::CategoryTotals totals{};
+    std::array<bool, TransactionColumns::CATEGORY_COUNT> present{};
+    auto best = [](auto&& fn) {
+        double fastest = 1e9;
+        for (int run = 0; run < 5; ++run) {
+            fastest = std::min(fastest, harness::seconds(fn));
+        }
+        return fastest;
+    };
+    double aos = best([&] {
+        totals.fill(0.0);
+        for (const auto& trans : transactions) {
+            totals[static_cast<int>(trans.getCategory())] += trans.getAmount();
+            present[static_cast<int>(trans.getCategory())] = true;
+        }
+    });
+    double soa = best([&] { columns.sumByCategory(totals, present); });
+    std::printf("%zu rows: AoS %.0f Mrows/s, SoA %.0f Mrows/s\n", rows, rows / aos / 1e6, rows / soa / 1e6);
+}
+
+// Registration and login latency with a million users registered. Every
+// user registered here stays loaded, about 420 MB per million, so pass a
+// larger count only on a machine with the memory for it.
+PFM_CASE(user_index) {
+    size_t users = harness::argument(args, 0, 1000000);
+    UserManager manager;
+    FileManager::beginBatch();
+    double registration = harness::seconds([&] {
+        for (size_t i = 0; i < users; ++i) {
+            manager.registerUser("user" + std::to_string(i), "secret");
+        }
+    });
+    FileManager::commitBatch();
+    const int probes = 1000;
+    double registerLast = harness::seconds([&] {
+        for (int i = 0; i < probes; ++i) {
+            manager.registerUser("late" + std::to_string(i), "secret");
+        }
+    });
+    double login = harness::seconds([&] {
+        for (int i = 0; i < probes; ++i) {
+            manager.authenticateUser("user" + std::to_string(i * 997 % users), "secret");
+        }
+    });
+    std::printf("%zu users registered in %.2f s; at that size: register %.1f us, login %.1f us\n", users,
+                registration, registerLast / probes * 1e6, login / probes * 1e6);
+}
+
+// TransactionDateIndex at 10M rows: a backdated erase plus re-insert, and a
+// 30-day category total from the index against a scan of every row with
+// the range kernel.
+PFM_CASE(date_index) {
+    size_t rows = harness::argument(args, 0, 10000000);
+    std::vector<Transaction> transactions = syntheticRows(rows);
+    TransactionColumns columns;
+    columns.reserve(rows);
+    for (const auto& trans : transactions) {
+        columns.push(trans);
+    }
+    TransactionDateIndex index;
+    index.build(columns);
+    const int edits = 10000;
+    double edit = harness::seconds([&] {
+        for (int i = 0; i < edits; ++i) {
+            const Transaction& trans = transactions[static_cast<size_t>(i) * 7919 % rows];
+            index.erase(trans);
+            index.insert(trans);
+        }
+    });
+    const int queries = 1000;
+    const time_t start = 1600000000;
+    double sink = 0.0;
+    double ranged = harness::seconds([&] {
+        for (int i = 0; i < queries; ++i) {
+            time_t from = start + static_cast<time_t>(i) * 86400;
+            sink += index.between(from, from + 30 * 86400).totalsByCategory()[0];
+        }
+    });
+    double scanned = harness::seconds([&] {
+        for (int i = 0; i < queries / 10; ++i) {
+            time_t from = start + static_cast<time_t>(i) * 86400;
+            sink += columns.sumByCategoryInRange(from, from + 30 * 86400)[0];
+        }
+    });
+    CHECK(sink > 0.0);
+    std::printf("%zu rows: erase+insert %.2f us, 30-day totals %.1f us indexed, %.1f us scanned\n", rows,
+                edit / edits * 1e6, ranged / queries * 1e6, scanned / (queries / 10) * 1e6);
+}
+
+// Readers taking a snapshot and a 30-day query in a loop while one writer
+// adds transactions to a 1M-row account, with file writes queued so the
+// writer measures the in-memory path. Each write forces the next snapshot to
+// be rebuilt.
+PFM_CASE(snapshot_contention) {
+    size_t rows = harness::argument(args, 0, 1000000);
+    const int writes = 2000;
+    Account account("Bench", 0.0);
+    account.addTransactions(syntheticRows(rows));
+    FileManager::enableWriteBehind(std::chrono::hours(1), std::numeric_limits<size_t>::max());
+    std::printf("%8s %12s %16s %16s\n", "readers", "us/write", "us/snapshot", "us/slowest");
+    for (int readers : {0, 1, 4}) {
+        std::atomic<bool> done{false};
+        std::atomic<uint64_t> snapshots{0};
+        std::atomic<uint64_t> readNanos{0};
+        std::atomic<uint64_t> slowestNanos{0};
+        std::vector<std::thread> threads;
+        for (int r = 0; r < readers; ++r) {
+            threads.emplace_back([&] {
+                while (!done.load()) {
+                    auto start = std::chrono::steady_clock::now();
+                    std::shared_ptr<const AccountSnapshot> snapshot = account.snapshot();
+                    snapshot->spendingBetween(1600000000, 1600000000 + 30 * 86400);
+                    uint64_t nanos = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                                         std::chrono::steady_clock::now() - start).count();
+                    readNanos += nanos;
+                    uint64_t slowest = slowestNanos.load();
+                    while (nanos > slowest && !slowestNanos.compare_exchange_weak(slowest, nanos)) {
+                    }
+                    ++snapshots;
+                }
+            });
+        }
+        double elapsed = harness::seconds([&] {
+            for (int i = 0; i < writes; ++i) {
+                account.addTransaction(Transaction(1.0, SpendingCategory::FOOD, "coffee"));
+            }
+        });
+        done = true;
+        for (auto& thread : threads) {
+            thread.join();
+        }
+        double perSnapshot = snapshots ? readNanos.load() / 1e3 / snapshots.load() : 0.0;
+        std::printf("%8d %12.1f %16.1f %16.1f\n", readers, elapsed / writes * 1e6, perSnapshot,
+                    slowestNanos.load() / 1e3);
+    }
+    FileManager::disableWriteBehind();
+}
+
+// DescriptionIndex at 10M rows, built in batches of synthetic rows: a
+// two-word query, a prefix query, and each with a category and 30-day
+// filter, for every match and for the first 20.
+PFM_CASE(description_search) {
+    size_t rows = harness::argument(args, 0, 10000000);
+    const size_t batch = 1000000;
+    DescriptionIndex index;
+    double build = harness::seconds([&] {
+        for (size_t done = 0; done < rows; done += batch) {
+            for (const auto& trans : syntheticRows(std::min(batch, rows - done), done + 1)) {
+                index.add(trans);
+            }
+            index.normalize();
+        }
+    });
+    DescriptionIndex::Filter any;
+    DescriptionIndex::Filter narrow;
+    narrow.category = static_cast<int>(SpendingCategory::FOOD);
+    narrow.start = 1650000000;
+    narrow.end = narrow.start + 30 * 86400;
+    std::printf("%zu rows, %zu postings, built in %.1f s, %.0f MB\n", rows, index.size(), build,
+                index.memoryUsage() / 1e6);
+    std::printf("%-14s %-10s %6s %10s %12s\n", "query", "filter", "limit", "matches", "us/query");
+    for (const char* query : {"merchant 42", "merchant 12*"}) {
+        for (const DescriptionIndex::Filter* filter : {&any, &narrow}) {
+            for (size_t limit : {size_t(0), size_t(20)}) {
+                const int runs = 20;
+                size_t matches = 0;
+                double elapsed = harness::seconds([&] {
+                    for (int i = 0; i < runs; ++i) {
+                        matches = index.search(query, *filter, limit).size();
+                    }
+                });
+                std::printf("%-14s %-10s %6zu %10zu %12.1f\n", query, filter == &any ? "none" : "food 30d", limit,
+                            matches, elapsed / runs * 1e6);
+            }
+        }
+    }
+}
+
+int main(int argc, char* argv[]) {
+    return harness::runMain(argc, argv);
+}
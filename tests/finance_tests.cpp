@@ -0,0 +1,967 @@
+// Functional tests. Build the finance_tests target and run it through ctest,
+// or run "finance_tests <case>" directly.
+#include "harness.h"
+
+namespace {
+
+std::string fileContent(const std::string& filename) {
+    return FileManager::readFromFile(filename);
+}
+
+// Serialized rows of an account, in storage order.
+std::vector<std::string> rowsOf(const Account& account) {
+    std::vector<std::string> rows;
+    for (const auto& trans : account.snapshot()->transactions) {
+        rows.push_back(trans.serialize());
+    }
+    return rows;
+}
+
+}  // namespace
+
+PFM_CASE(journal_replay) {
+    Account account("Journal", 100.0);
+    std::vector<EntityId> ids;
+    for (int i = 0; i < 10; ++i) {
+        Transaction trans(1.0 + i, SpendingCategory::FOOD, "row " + std::to_string(i));
+        ids.push_back(trans.getId());
+        account.addTransaction(trans);
+    }
+    account.editTransaction(ids[3], 42.0, SpendingCategory::TRANSPORT, "edited");
+    account.deleteTransaction(ids[0]);
+    account.deleteTransaction(ids[7]);
+
+    std::string journal = fileContent("data/accounts/" + std::to_string(account.getId()) + "/journal_" +
+                                      std::to_string(account.getId()) + ".txt");
+    CHECK(std::count(journal.begin(), journal.end(), '\n') == 13);
+
+    Account reloaded(account.getId());
+    CHECK(rowsOf(reloaded) == rowsOf(account));
+    CHECK(reloaded.getBalance() == account.getBalance());
+}
+
+PFM_CASE(journal_compaction) {
+    Account account("Compaction", 0.0);
+    std::string dir = "data/accounts/" + std::to_string(account.getId());
+    std::string journalFile = dir + "/journal_" + std::to_string(account.getId()) + ".txt";
+    for (int i = 0; i < 1100; ++i) {
+        account.addTransaction(Transaction(1.0, SpendingCategory::FOOD, "x"));
+    }
+    // The journal was folded into the base file at 1024 records.
+    std::string journal = fileContent(journalFile);
+    CHECK(std::count(journal.begin(), journal.end(), '\n') == 1100 - 1024);
+
+    Account reloaded(account.getId());
+    CHECK(reloaded.snapshot()->transactions.size() == 1100);
+    CHECK(rowsOf(reloaded) == rowsOf(account));
+}
+
+// A crash between rewriting the base file and truncating the journal leaves
+// records in both; replay must not apply them twice.
+PFM_CASE(journal_replay_after_compaction_is_idempotent) {
+    Account account("Replay", 0.0);
+    std::string dir = "data/accounts/" + std::to_string(account.getId());
+    Transaction kept(5.0, SpendingCategory::FOOD, "kept");
+    account.addTransaction(kept);
+    Transaction removed(7.0, SpendingCategory::FOOD, "removed");
+    account.addTransaction(removed);
+    account.deleteTransaction(removed.getId());
+    // The compacted base, with the journal not yet truncated.
+    FileManager::saveToFile(dir + "/transactions_" + std::to_string(account.getId()) + ".txt",
+                            kept.serialize() + "\n");
+
+    Account reloaded(account.getId());
+    CHECK(reloaded.snapshot()->transactions.size() == 1);
+    CHECK(reloaded.snapshot()->transactions[0].getId() == kept.getId());
+}
+
+// refresh() reloads only when the journal's mtime, size or FileManager
+// generation moved since it was last read or written.
+PFM_CASE(transactions_reload_only_when_their_files_change) {
+    Account account("Reload", 0.0);
+    Transaction row(1.0, SpendingCategory::FOOD, "row");
+    account.addTransaction(row);
+    FileManager::flush();
+    std::string dir = "data/accounts/" + std::to_string(account.getId());
+    std::string journalFile = dir + "/journal_" + std::to_string(account.getId()) + ".txt";
+
+    auto unchanged = account.snapshot();
+    account.refresh();
+    CHECK(account.snapshot() == unchanged);
+
+    // Same size, new mtime.
+    std::string journal = fileContent(journalFile);
+    size_t amount = journal.find(",1,0,row,");
+    CHECK(amount != std::string::npos);
+    journal[amount + 1] = '2';
+    auto mtime = std::filesystem::last_write_time(journalFile);
+    std::ofstream(journalFile, std::ios::binary) << journal;
+    std::filesystem::last_write_time(journalFile, mtime + std::chrono::seconds(2));
+    account.refresh();
+    CHECK(account.snapshot()->transactions.size() == 1);
+    CHECK(account.snapshot()->transactions[0].getAmount() == 2.0);
+
+    // New size.
+    std::ofstream(journalFile, std::ios::binary | std::ios::app) << "-," << row.getId() << "\n";
+    account.refresh();
+    CHECK(account.snapshot()->transactions.empty());
+    CHECK(account.getBalance() == 0.0);
+    CHECK(account.snapshot()->getTotalMonthlySpending() == 0.0);
+
+    // A write through FileManager, even one that keeps the bytes and mtime.
+    mtime = std::filesystem::last_write_time(journalFile);
+    FileManager::saveToFile(journalFile, fileContent(journalFile));
+    std::filesystem::last_write_time(journalFile, mtime);
+    unchanged = account.snapshot();
+    account.refresh();
+    CHECK(account.snapshot() != unchanged);
+    CHECK(account.snapshot()->transactions.empty());
+}
+
+// The (month, category) totals follow adds, in-place edits and deletes, and
+// a reload rebuilds the same totals.
+PFM_CASE(monthly_index_follows_add_edit_and_delete) {
+    Account account("Monthly", 0.0);
+    std::vector<EntityId> ids;
+    time_t now = std::time(nullptr);
+    for (int i = 0; i < 60; ++i) {
+        Transaction trans(IdGenerator::next(), 1.0 + i, static_cast<SpendingCategory>(i % 8), "row",
+                          now - static_cast<time_t>(i % 4) * 40 * 86400, now, now);
+        ids.push_back(trans.getId());
+        account.addTransaction(trans);
+    }
+    for (int i = 0; i < 60; i += 7) {
+        account.editTransaction(ids[i], 100.0 + i, static_cast<SpendingCategory>((i + 3) % 8), "edited");
+    }
+    for (int i = 1; i < 60; i += 5) {
+        account.deleteTransaction(ids[i]);
+    }
+
+    auto matchesScan = [](const AccountSnapshot& snapshot) {
+        std::map<int, TransactionColumns::CategoryTotals> expected;
+        for (const auto& trans : snapshot.transactions) {
+            expected[DateUtils::monthKey(trans.getDate())][static_cast<int>(trans.getCategory())] += trans.getAmount();
+        }
+        for (const auto& [month, totals] : snapshot.monthlySpending) {
+            TransactionColumns::CategoryTotals wanted{};
+            if (expected.count(month)) {
+                wanted = expected[month];
+            }
+            if (totals != wanted) {
+                return false;
+            }
+        }
+        double current = 0.0;
+        for (double amount : expected[DateUtils::monthKey(std::time(nullptr))]) {
+            current += amount;
+        }
+        return expected.size() <= snapshot.monthlySpending.size() && snapshot.getTotalMonthlySpending() == current;
+    };
+    CHECK(matchesScan(*account.snapshot()));
+    CHECK(matchesScan(*Account(account.getId()).snapshot()));
+}
+
+PFM_CASE(edits_keep_order_and_created_at) {
+    Account account("Edit", 0.0);
+    std::vector<EntityId> ids;
+    for (int i = 0; i < 5; ++i) {
+        Transaction trans(IdGenerator::next(), 1.0 + i, SpendingCategory::FOOD, "row " + std::to_string(i),
+                          1700000000 + i, 1600000000, 1600000000);
+        ids.push_back(trans.getId());
+        account.addTransaction(trans);
+    }
+    account.editTransaction(ids[2], 42.0, SpendingCategory::TRANSPORT, "edited");
+
+    Account reloaded(account.getId());
+    for (const Account* loaded : {&account, &reloaded}) {
+        auto snapshot = loaded->snapshot();
+        const auto& rows = snapshot->transactions;
+        CHECK(rows.size() == ids.size());
+        for (size_t i = 0; i < rows.size(); ++i) {
+            CHECK(rows[i].getId() == ids[i]);
+            CHECK(rows[i].getCreatedAt() == 1600000000);
+            CHECK(rows[i].getDate() == static_cast<time_t>(1700000000 + i));
+        }
+        CHECK(rows[2].getAmount() == 42.0);
+        CHECK(rows[2].getCategory() == SpendingCategory::TRANSPORT);
+        CHECK(rows[2].getDescription() == "edited");
+        CHECK(rows[2].getUpdatedAt() > 1600000000);
+    }
+}
+
+// Imports arrive in file order, not id order; the posting lists must still
+// come out sorted and free of duplicates.
+PFM_CASE(description_index_out_of_order_load) {
+    Account account("Search", 0.0);
+    std::vector<Transaction> batch;
+    for (int i = 0; i < 200; ++i) {
+        batch.emplace_back(1.0, SpendingCategory::FOOD, i % 2 ? "rent rent paid" : "grocery run");
+    }
+    std::vector<EntityId> rent;
+    for (const auto& trans : batch) {
+        if (trans.getDescription() == "rent rent paid") {
+            rent.push_back(trans.getId());
+        }
+    }
+    std::reverse(batch.begin(), batch.end());
+    account.addTransactions(batch);
+
+    auto snapshot = account.snapshot();
+    CHECK(snapshot->searchTransactions("rent") == rent);
+    CHECK(snapshot->searchTransactions("rent paid") == rent);
+    CHECK(snapshot->searchTransactions("rent grocery").empty());
+
+    account.deleteTransaction(rent[5]);
+    rent.erase(rent.begin() + 5);
+    CHECK(account.snapshot()->searchTransactions("paid") == rent);
+
+    Account reloaded(account.getId());
+    CHECK(reloaded.snapshot()->searchTransactions("rent") == rent);
+}
+
+PFM_CASE(import_assigns_ids_in_file_order) {
+    std::stringstream csv;
+    csv << "Date,Amount,Description\n";
+    for (int i = 0; i < 3000; ++i) {
+        csv << "2024-01-" << (10 + i % 19) << "," << (i + 1) << ",row " << i << "\n";
+    }
+    Account account("Import", 0.0);
+    ThreadPool pool(4);
+    TransactionImporter::Options options;
+    options.memoryLimit = 1;  // smallest chunks, so many parse concurrently
+    TransactionImporter importer(pool, options);
+    CHECK(importer.importCsv(csv, account).rowsImported == 3000);
+
+    const auto& rows = account.snapshot()->transactions;
+    CHECK(rows.size() == 3000);
+    for (size_t i = 1; i < rows.size(); ++i) {
+        CHECK(rows[i - 1].getId() < rows[i].getId());
+        CHECK(rows[i].getAmount() == static_cast<double>(i + 1));
+    }
+}
+
+PFM_CASE(import_matches_category_keywords_as_words) {
+    std::stringstream csv("Date,Amount,Description\n"
+                          "2024-01-01,1,Parent teacher association\n"
+                          "2024-01-02,2,Monthly rent\n"
+                          "2024-01-03,3,GROCERY-OUTLET #12\n"
+                          "2024-01-04,4,Cell phone bill\n"
+                          "2024-01-05,5,Facebook ads\n");
+    Account account("Keywords", 0.0);
+    ThreadPool pool(2);
+    TransactionImporter importer(pool);
+    importer.importCsv(csv, account);
+
+    std::vector<SpendingCategory> categories;
+    for (const auto& trans : account.snapshot()->transactions) {
+        categories.push_back(trans.getCategory());
+    }
+    CHECK(categories == std::vector<SpendingCategory>({SpendingCategory::MISCELLANEOUS, SpendingCategory::HOUSING,
+                                                       SpendingCategory::FOOD, SpendingCategory::UTILITIES,
+                                                       SpendingCategory::MISCELLANEOUS}));
+}
+
+PFM_CASE(projection_rejects_oversized_scenarios) {
+    Account account("Projection", 100.0);
+    account.addTransaction(Transaction(20.0, SpendingCategory::FOOD, "lunch"));
+    ThreadPool pool(2);
+    SavingsSimulator simulator(pool);
+    auto rejects = [&](int months, size_t paths) {
+        SavingsSimulator::Scenario scenario;
+        scenario.months = months;
+        scenario.paths = paths;
+        try {
+            simulator.project(*account.snapshot(), scenario);
+        } catch (const std::runtime_error&) {
+            return true;
+        }
+        return false;
+    };
+    CHECK(rejects(0, 100));
+    CHECK(rejects(12, 0));
+    CHECK(rejects(SavingsSimulator::MAX_MONTHS + 1, 100));
+    CHECK(rejects(12, SavingsSimulator::MAX_PATHS + 1));
+    CHECK(rejects(SavingsSimulator::MAX_MONTHS, SavingsSimulator::MAX_PATHS));
+    CHECK(rejects(1000, std::numeric_limits<size_t>::max() / 500));
+    CHECK(!rejects(12, 1000));
+}
+
+// dayNumber caches the current day per thread; it must agree with the local
+// date across DST changes, including Lord Howe's half-hour shift.
+PFM_CASE(day_number_follows_local_dates) {
+    std::string saved = std::getenv("TZ") ? std::getenv("TZ") : "";
+    for (const char* zone : {"America/New_York", "Australia/Lord_Howe", "UTC"}) {
+        setenv("TZ", zone, 1);
+        tzset();
+        for (time_t time = 1672531200; time < 1672531200 + 2 * 366 * 86400; time += 677) {
+            std::tm tm = DateUtils::toLocalTime(time);
+            time_t local = time + tm.tm_gmtoff;
+            int expected = static_cast<int>((local - (((local % 86400) + 86400) % 86400)) / 86400);
+            CHECK(DateUtils::dayNumber(time) == expected);
+        }
+    }
+    if (saved.empty()) {
+        unsetenv("TZ");
+    } else {
+        setenv("TZ", saved.c_str(), 1);
+    }
+    tzset();
+}
+
+PFM_CASE(ids_are_unique_across_threads) {
+    const int threads = 8;
+    const int perThread = 200000;
+    std::vector<std::vector<EntityId>> issued(threads);
+    std::vector<std::thread> workers;
+    for (int t = 0; t < threads; ++t) {
+        workers.emplace_back([&issued, t] {
+            issued[t].reserve(perThread);
+            for (int i = 0; i < perThread; ++i) {
+                issued[t].push_back(IdGenerator::next());
+            }
+        });
+    }
+    for (auto& worker : workers) {
+        worker.join();
+    }
+    std::vector<EntityId> all;
+    for (const auto& ids : issued) {
+        CHECK(std::is_sorted(ids.begin(), ids.end()));
+        all.insert(all.end(), ids.begin(), ids.end());
+    }
+    std::sort(all.begin(), all.end());
+    CHECK(std::adjacent_find(all.begin(), all.end()) == all.end());
+}
+
+#ifndef _WIN32
+// Processes sharing a data directory claim distinct node ids, so ids
+// generated in the same millisecond by different processes never collide.
+PFM_CASE(ids_are_unique_across_processes) {
+    const int processes = 8;
+    const int perProcess = 50000;
+    // Run the parent's ids ahead of the clock, so the children start by
+    // continuing from an id issued under another node.
+    for (int i = 0; i < 200000; ++i) {
+        IdGenerator::next();
+    }
+    std::vector<pid_t> children;
+    for (int p = 0; p < processes; ++p) {
+        pid_t pid = fork();
+        if (pid == 0) {
+            uint64_t node = IdGenerator::claimNodeId("data/nodes");
+            std::vector<EntityId> ids{node};
+            for (int i = 0; i < perProcess; ++i) {
+                ids.push_back(IdGenerator::next());
+            }
+            std::ofstream out("ids_" + std::to_string(p), std::ios::binary);
+            out.write(reinterpret_cast<const char*>(ids.data()), ids.size() * sizeof(EntityId));
+            out.close();
+            _exit(out ? 0 : 1);
+        }
+        CHECK(pid > 0);
+        children.push_back(pid);
+    }
+    for (pid_t pid : children) {
+        int status = 0;
+        waitpid(pid, &status, 0);
+        CHECK(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+    }
+    std::set<EntityId> nodes;
+    std::vector<EntityId> all;
+    for (int p = 0; p < processes; ++p) {
+        std::string data = fileContent("ids_" + std::to_string(p));
+        CHECK(data.size() == (perProcess + 1) * sizeof(EntityId));
+        std::vector<EntityId> ids(perProcess + 1);
+        std::memcpy(ids.data(), data.data(), data.size());
+        nodes.insert(ids[0]);
+        all.insert(all.end(), ids.begin() + 1, ids.end());
+    }
+    CHECK(nodes.size() == processes);
+    std::sort(all.begin(), all.end());
+    CHECK(std::adjacent_find(all.begin(), all.end()) == all.end());
+}
+#endif
+
+// A flush that fails part way must not apply the same append twice when it
+// is retried: deposits and account lists are not idempotent on replay.
+PFM_CASE(failed_flush_requeues_only_unapplied_writes) {
+    FileManager::createDirectory("data");
+    FileManager::beginBatch();
+    FileManager::appendToFile("data/a.txt", "a1\n");
+    FileManager::appendToFile("data/b.txt", "b1\n");
+    FileManager::faultHook() = [](const char* operation, const std::string& filename) {
+        if (std::string(operation) == "sync" && filename == "data/b.txt") {
+            throw std::runtime_error("injected fsync failure");
+        }
+    };
+    bool failed = false;
+    try {
+        FileManager::commitBatch();
+    } catch (const std::runtime_error&) {
+        failed = true;
+    }
+    FileManager::faultHook() = nullptr;
+    CHECK(failed);
+    CHECK(FileManager::hasPendingWrites("data/b.txt"));
+    FileManager::appendToFile("data/a.txt", "a2\n");
+    FileManager::flush();
+    CHECK(fileContent("data/a.txt") == "a1\na2\n");
+    CHECK(fileContent("data/b.txt") == "b1\n");
+
+    // A failed rename leaves the replacement queued, in order, behind the
+    // append before it.
+    FileManager::beginBatch();
+    FileManager::appendToFile("data/a.txt", "a3\n");
+    FileManager::saveToFile("data/b.txt", "b2\n");
+    FileManager::faultHook() = [](const char* operation, const std::string&) {
+        if (std::string(operation) == "rename") {
+            throw std::runtime_error("injected rename failure");
+        }
+    };
+    failed = false;
+    try {
+        FileManager::commitBatch();
+    } catch (const std::runtime_error&) {
+        failed = true;
+    }
+    FileManager::faultHook() = nullptr;
+    CHECK(failed);
+    CHECK(fileContent("data/a.txt") == "a1\na2\na3\n");
+    FileManager::flush();
+    CHECK(fileContent("data/a.txt") == "a1\na2\na3\n");
+    CHECK(fileContent("data/b.txt") == "b2\n");
+}
+
+#ifndef _WIN32
+// Compaction queued behind journal appends in a batch: crashing before any
+// one of its writes, fsyncs or renames must never lose committed records.
+PFM_CASE(compaction_survives_a_crash_at_every_step) {
+    Account account("Crash", 0.0);
+    std::vector<Transaction> committed;
+    for (int i = 0; i < 1023; ++i) {
+        committed.emplace_back(1.0 + i, SpendingCategory::FOOD, "committed " + std::to_string(i));
+    }
+    account.addTransactions(committed);
+    FileManager::flush();
+    std::vector<std::string> before = rowsOf(account);
+    std::filesystem::copy("data", "data.before", std::filesystem::copy_options::recursive);
+
+    int operation = 1;
+    for (; operation < 100; ++operation) {
+        bool crashed = harness::crashAfter(operation, [&account] {
+            FileManager::beginBatch();
+            account.addTransaction(Transaction(99.0, SpendingCategory::FOOD, "compacting"));
+            account.deposit(10.0);
+            FileManager::commitBatch();
+        });
+        std::vector<std::string> after = rowsOf(Account(account.getId()));
+        CHECK(after.size() == before.size() || after.size() == before.size() + 1);
+        CHECK(std::equal(before.begin(), before.end(), after.begin()));
+        std::filesystem::remove_all("data");
+        std::filesystem::copy("data.before", "data", std::filesystem::copy_options::recursive);
+        if (!crashed) {
+            break;
+        }
+    }
+    CHECK(operation > 4 && operation < 100);
+}
+
+// A crash anywhere in a format switch must leave one complete base file
+// named by the info file, with the journal still applied on top.
+PFM_CASE(storage_format_switch_survives_a_crash_at_every_step) {
+    Account account("Switch", 0.0);
+    std::vector<Transaction> compacted;
+    for (int i = 0; i < 2000; ++i) {
+        compacted.emplace_back(1.0 + i, SpendingCategory::FOOD, "compacted " + std::to_string(i));
+    }
+    account.addTransactions(compacted);
+    for (int i = 0; i < 10; ++i) {
+        account.addTransaction(Transaction(0.5, SpendingCategory::TRANSPORT, "journaled " + std::to_string(i)));
+    }
+    FileManager::flush();
+    std::vector<std::string> before = rowsOf(account);
+    std::filesystem::copy("data", "data.before", std::filesystem::copy_options::recursive);
+
+    int operation = 1;
+    for (; operation < 100; ++operation) {
+        bool crashed = harness::crashAfter(operation, [&account] {
+            account.setStorageFormat(StorageFormat::BINARY);
+        });
+        Account reloaded(account.getId());
+        CHECK(rowsOf(reloaded) == before);
+        CHECK(crashed || reloaded.getStorageFormat() == StorageFormat::BINARY);
+        std::filesystem::remove_all("data");
+        std::filesystem::copy("data.before", "data", std::filesystem::copy_options::recursive);
+        if (!crashed) {
+            break;
+        }
+    }
+    CHECK(operation > 6 && operation < 100);
+}
+
+// The balance in the info file is written after the row it reflects; a crash
+// in between must not leave the reloaded balance out of step with the rows.
+PFM_CASE(balance_matches_the_rows_after_a_crash) {
+    Account account("Balance", 100.0);
+    account.addTransaction(Transaction(10.0, SpendingCategory::FOOD, "first"));
+    FileManager::flush();
+    std::filesystem::copy("data", "data.before", std::filesystem::copy_options::recursive);
+
+    int operation = 1;
+    for (; operation < 100; ++operation) {
+        bool crashed = harness::crashAfter(operation, [&account] {
+            account.addTransaction(Transaction(25.0, SpendingCategory::FOOD, "second"));
+            account.deposit(5.0);
+        });
+        Account reloaded(account.getId());
+        double expected = 100.0;
+        for (const auto& trans : reloaded.snapshot()->transactions) {
+            expected -= trans.getAmount();
+        }
+        for (const auto& deposit : reloaded.snapshot()->deposits) {
+            expected += deposit.amount;
+        }
+        CHECK(reloaded.getBalance() == expected);
+        CHECK(Account::readInfo(account.getId()).balance == expected);
+        std::filesystem::remove_all("data");
+        std::filesystem::copy("data.before", "data", std::filesystem::copy_options::recursive);
+        if (!crashed) {
+            CHECK(expected == 70.0);
+            break;
+        }
+    }
+    CHECK(operation > 2 && operation < 100);
+}
+#endif
+
+// Users land in users_<n>.txt for n = FNV-1a(username) % 64, and an old flat
+// users.txt is moved into the shards once.
+PFM_CASE(users_are_sharded_and_migrated_from_the_flat_file) {
+    auto shardOf = [](const std::string& username) {
+        uint64_t hash = 1469598103934665603ULL;
+        for (unsigned char c : username) {
+            hash = (hash ^ c) * 1099511628211ULL;
+        }
+        return std::to_string(hash % 64);
+    };
+    auto storedIn = [](const std::string& username, const std::string& shard) {
+        std::string records = fileContent("data/users/users_" + shard + ".txt");
+        std::string index = fileContent("data/users/users_" + shard + ".idx");
+        return records.find(username + ",") != std::string::npos && ("\n" + index).find("\n" + username + ",") != std::string::npos;
+    };
+
+    FileManager::createDirectory("data/users");
+    std::string legacy;
+    for (const char* name : {"dave", "erin", "frank"}) {
+        legacy += User(name, std::string(name) + "-pw").serialize() + "\n";
+    }
+    FileManager::saveToFile("data/users/users.txt", legacy);
+    {
+        UserManager users;
+        CHECK(!std::filesystem::exists("data/users/users.txt"));
+        CHECK(std::filesystem::exists("data/users/users.txt.migrated"));
+        CHECK(users.registerUser("grace", "grace-pw"));
+    }
+    UserManager restarted;
+    for (const char* name : {"dave", "erin", "frank", "grace"}) {
+        CHECK(storedIn(name, shardOf(name)));
+        CHECK(restarted.authenticateUser(name, std::string(name) + "-pw") != nullptr);
+        CHECK(restarted.authenticateUser(name, "wrong") == nullptr);
+    }
+    CHECK(!restarted.registerUser("dave", "again"));
+}
+
+// A user's accounts are listed after a restart without loading them, and
+// each one loads its rows when opened.
+PFM_CASE(account_directory_survives_a_restart) {
+    std::vector<EntityId> ids;
+    {
+        UserManager users;
+        CHECK(users.registerUser("heidi", "secret"));
+        User* user = users.authenticateUser("heidi", "secret");
+        for (const char* name : {"Everyday", "Savings, joint"}) {
+            auto account = std::make_shared<Account>(name, 100.0);
+            account->addTransaction(Transaction(25.0, SpendingCategory::FOOD, "groceries"));
+            ids.push_back(account->getId());
+            user->addAccount(account);
+        }
+    }
+    FileManager::flush();
+    AccountCache::setMemoryBudget(0);  // drop every loaded account
+
+    UserManager restarted;
+    User* user = restarted.authenticateUser("heidi", "secret");
+    CHECK(user != nullptr);
+    std::vector<AccountHandle> accounts = user->getAccounts();
+    CHECK(accounts.size() == 2);
+    CHECK(accounts[0].getId() == ids[0] && accounts[0].getName() == "Everyday");
+    CHECK(accounts[1].getId() == ids[1] && accounts[1].getName() == "Savings, joint");
+    CHECK(!accounts[0].isLoaded() && !accounts[1].isLoaded());
+    CHECK(accounts[1].getBalance() == 75.0);
+    std::shared_ptr<Account> opened = user->openAccount(1);
+    CHECK(accounts[1].isLoaded());
+    CHECK(opened->snapshot()->transactions.size() == 1);
+    CHECK(!accounts[0].isLoaded());
+    AccountCache::setMemoryBudget(AccountCache::DEFAULT_MEMORY_BUDGET);
+}
+
+PFM_CASE(failed_registration_leaves_no_user) {
+    UserManager users;
+    FileManager::faultHook() = [](const char* operation, const std::string& filename) {
+        if (std::string(operation) == "write" && filename.find("data/users/") == 0) {
+            throw std::runtime_error("injected write failure");
+        }
+    };
+    bool failed = false;
+    try {
+        users.registerUser("carol", "secret");
+    } catch (const std::runtime_error&) {
+        failed = true;
+    }
+    FileManager::faultHook() = nullptr;
+    CHECK(failed);
+    CHECK(users.authenticateUser("carol", "secret") == nullptr);
+    CHECK(users.registerUser("carol", "secret"));
+
+    UserManager restarted;
+    CHECK(restarted.authenticateUser("carol", "secret") != nullptr);
+}
+
+PFM_CASE(storage_format_switches_through_serve) {
+    UserManager users;
+    CommandSession session(users);
+    CHECK(session.execute("register alice secret") == "OK\n");
+    CHECK(session.execute("login alice secret") == "OK\n");
+    std::string created = session.execute("create-account 100 Everyday");
+    EntityId id = std::stoull(created.substr(3));
+    CHECK(session.execute("select 1") == created);
+    for (int i = 0; i < 20; ++i) {
+        session.execute("record " + std::to_string(i + 1) + " 1 groceries " + std::to_string(i));
+    }
+    std::vector<std::string> rows = rowsOf(Account(id));
+    CHECK(session.execute("storage-format") == "OK text\n");
+    CHECK(session.execute("storage-format binary") == "OK binary\n");
+    CHECK(std::filesystem::exists("data/accounts/" + std::to_string(id) + "/transactions_" +
+                                  std::to_string(id) + ".bin"));
+    FileManager::flush();
+    CHECK(rowsOf(Account(id)) == rows);
+    CHECK(session.execute("storage-format csv").rfind("ERR", 0) == 0);
+    CHECK(session.execute("storage-format text") == "OK text\n");
+    FileManager::flush();
+    CHECK(rowsOf(Account(id)) == rows);
+}
+
+// A corrupt row count must be rejected before it sizes anything.
+PFM_CASE(binary_format_rejects_corrupt_headers) {
+    std::vector<Transaction> rows;
+    for (int i = 0; i < 10; ++i) {
+        rows.emplace_back(1.0 + i, SpendingCategory::FOOD, "row");
+    }
+    std::string data = BinaryTransactionFormat::encode(rows);
+    auto rejects = [](const std::string& corrupt) {
+        std::vector<Transaction> decoded;
+        try {
+            BinaryTransactionFormat::decode(corrupt, decoded);
+        } catch (const std::runtime_error&) {
+            return true;
+        }
+        return false;
+    };
+    CHECK(!rejects(data));
+    for (uint64_t rowCount : {uint64_t(11), uint64_t(1) << 60, ~uint64_t(0) / 8 + 1, ~uint64_t(0)}) {
+        std::string corrupt = data;
+        std::memcpy(&corrupt[8], &rowCount, sizeof(rowCount));
+        CHECK(rejects(corrupt));
+    }
+    std::string badCategory = data;
+    // The heap holds ten "row"s and follows ten category bytes padded to 16.
+    badCategory[badCategory.size() - 30 - 16 + 2] = 42;
+    CHECK(rejects(badCategory));
+}
+
+PFM_CASE(report_all_writes_one_report_per_account) {
+    UserManager users;
+    CommandSession session(users);
+    session.execute("register bob secret");
+    session.execute("login bob secret");
+    std::string first = session.execute("create-account 100 Checking");
+    std::string second = session.execute("create-account 50 Savings");
+    session.execute("select 1");
+    session.execute("record 12.5 0 groceries");
+    session.execute("record 40 2 rent");
+    session.execute("select 2");
+    session.execute("record 7 0 coffee");
+
+    std::string reply = session.execute("report-all reports");
+    CHECK(reply.rfind("OK 2\n", 0) == 0);
+    for (const std::string& created : {first, second}) {
+        std::string path = "reports/report_" + created.substr(3, created.size() - 4) + ".txt";
+        CHECK(reply.find(path) != std::string::npos);
+        CHECK(std::filesystem::exists(path));
+    }
+    std::string report = fileContent("reports/report_" + first.substr(3, first.size() - 4) + ".txt");
+    CHECK(report.find("Food") != std::string::npos);
+    CHECK(report.find("12.50") != std::string::npos);
+    CHECK(session.execute("report-all").rfind("ERR", 0) == 0);
+}
+
+PFM_CASE(spending_kernels_match_a_plain_loop) {
+    std::mt19937_64 random(3);
+    for (size_t n : {0, 1, 3, 4, 5, 1000, 1003}) {
+        std::vector<double> amounts(n);
+        std::vector<uint8_t> categories(n);
+        std::vector<int64_t> dates(n);
+        for (size_t i = 0; i < n; ++i) {
+            amounts[i] = static_cast<double>(random() % 10000) / 4;  // exact sums in any order
+            categories[i] = static_cast<uint8_t>(i % 7 == 0 ? 200 + random() % 56 : random() % 8);
+            dates[i] = static_cast<int64_t>(random() % 100);
+        }
+        double all[8], inRange[8], expectedAll[8] = {}, expectedInRange[8] = {};
+        for (size_t i = 0; i < n; ++i) {
+            if (categories[i] < 8) {
+                expectedAll[categories[i]] += amounts[i];
+                if (dates[i] >= 20 && dates[i] < 60) {
+                    expectedInRange[categories[i]] += amounts[i];
+                }
+            }
+        }
+        SpendingKernels::sumByCategory(amounts.data(), categories.data(), n, all);
+        SpendingKernels::sumByCategoryInRange(amounts.data(), categories.data(), dates.data(), n, 20, 60, inRange);
+        for (int c = 0; c < 8; ++c) {
+            CHECK(all[c] == expectedAll[c]);
+            CHECK(inRange[c] == expectedInRange[c]);
+        }
+    }
+}
+
+PFM_CASE(account_cache_loads_each_account_once) {
+    EntityId id;
+    {
+        Account account("Cached", 10.0);
+        account.addTransaction(Transaction(1.0, SpendingCategory::FOOD, "first"));
+        id = account.getId();
+    }
+    AccountCache::Stats before = AccountCache::getStats();
+    std::vector<std::shared_ptr<Account>> opened(8);
+    std::vector<std::thread> threads;
+    for (size_t t = 0; t < opened.size(); ++t) {
+        threads.emplace_back([&opened, t, id] { opened[t] = AccountCache::get(id); });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    AccountCache::Stats after = AccountCache::getStats();
+    for (const auto& account : opened) {
+        CHECK(account == opened[0]);
+    }
+    CHECK(after.misses - before.misses == 1);
+    CHECK(after.hits - before.hits == opened.size() - 1);
+
+    // Evicting a dirty account flushes its queued writes first.
+    FileManager::enableWriteBehind(std::chrono::hours(1), 1000000);
+    opened[0]->addTransaction(Transaction(2.0, SpendingCategory::FOOD, "second"));
+    CHECK(opened[0]->isDirty());
+    opened.clear();
+    AccountCache::setMemoryBudget(0);
+    CHECK(AccountCache::peek(id) == nullptr);
+    CHECK(!FileManager::hasPendingWrites("data/accounts/" + std::to_string(id) + "/journal_" +
+                                         std::to_string(id) + ".txt"));
+    AccountCache::setMemoryBudget(AccountCache::DEFAULT_MEMORY_BUDGET);
+    FileManager::disableWriteBehind();
+    CHECK(AccountCache::get(id)->snapshot()->transactions.size() == 2);
+
+    UserManager users;
+    CommandSession session(users);
+    CHECK(session.execute("cache-stats").rfind("OK ", 0) == 0);
+}
+
+PFM_CASE(date_index_matches_a_scan) {
+    std::mt19937_64 random(5);
+    TransactionDateIndex index;
+    std::vector<Transaction> live;
+    for (int step = 0; step < 20000; ++step) {
+        int action = static_cast<int>(random() % 4);
+        if (action == 0 && !live.empty()) {
+            size_t victim = random() % live.size();
+            index.erase(live[victim]);
+            live[victim] = live.back();
+            live.pop_back();
+        } else if (action == 1 && !live.empty()) {
+            Transaction& trans = live[random() % live.size()];
+            trans = Transaction(trans.getId(), static_cast<double>(random() % 1000), SpendingCategory::FOOD, "edited",
+                                trans.getDate(), trans.getDate(), trans.getDate());
+            index.update(trans);
+        } else {
+            // Mostly in date order, with some backdated rows.
+            time_t date = 1700000000 + static_cast<time_t>(step) * 60 - (random() % 8 == 0 ? random() % 1000000 : 0);
+            live.emplace_back(IdGenerator::next(), static_cast<double>(random() % 1000),
+                              static_cast<SpendingCategory>(random() % TransactionColumns::CATEGORY_COUNT), "row", date,
+                              date, date);
+            index.insert(live.back());
+        }
+        if (step % 500 != 0) {
+            continue;
+        }
+        CHECK(index.size() == live.size());
+        time_t start = 1700000000 + static_cast<time_t>(random() % 1200000) - 100000;
+        time_t end = start + static_cast<time_t>(random() % 400000);
+        TransactionDateIndex::Range range = index.between(start, end);
+        size_t expected = 0;
+        double expectedFood = 0.0;
+        for (const Transaction& trans : live) {
+            if (trans.getDate() >= start && trans.getDate() < end) {
+                ++expected;
+                if (trans.getCategory() == SpendingCategory::FOOD) {
+                    expectedFood += trans.getAmount();  // whole numbers: exact in any order
+                }
+            }
+        }
+        CHECK(range.size() == expected);
+        CHECK(range.total(SpendingCategory::FOOD) == expectedFood);
+        const TransactionDateIndex::Entry* previous = nullptr;
+        for (const TransactionDateIndex::Entry& entry : range) {
+            CHECK(previous == nullptr || *previous < entry);
+            previous = &entry;
+        }
+    }
+}
+
+PFM_CASE(snapshots_keep_their_state_across_writes) {
+    Account account("Snapshots", 1000.0);
+    std::vector<Transaction> rows;
+    for (int i = 0; i < 3000; ++i) {
+        time_t date = 1700000000 + static_cast<time_t>(i) * 3600;
+        rows.emplace_back(IdGenerator::next(), 1.0, SpendingCategory::FOOD, "row", date, date, date);
+    }
+    account.addTransactions(rows);
+    std::shared_ptr<const AccountSnapshot> before = account.snapshot();
+    std::vector<std::string> serialized;
+    for (const auto& trans : before->transactions) {
+        serialized.push_back(trans.serialize());
+    }
+    double balance = before->balanceAsOf(1800000000);
+
+    // Touch the first, a middle and the last chunk of every structure.
+    account.editTransaction(rows[0].getId(), 5.0, SpendingCategory::TRANSPORT, "edited");
+    account.deleteTransaction(rows[1500].getId());
+    account.addTransaction(Transaction(IdGenerator::next(), 7.0, SpendingCategory::FOOD, "late", 1700000000, 0, 0));
+    account.deposit(50.0, 1700000000);
+    std::shared_ptr<const AccountSnapshot> after = account.snapshot();
+
+    CHECK(before->transactions.size() == serialized.size());
+    for (size_t i = 0; i < serialized.size(); ++i) {
+        CHECK(before->transactions[i].serialize() == serialized[i]);
+    }
+    CHECK(before->transactionsBetween(0, 1800000000).size() == 3000);
+    CHECK(before->categorySpendingBetween(SpendingCategory::FOOD, 0, 1800000000) == 3000.0);
+    CHECK(before->getCategorySpending().count(SpendingCategory::TRANSPORT) == 0);
+    CHECK(before->balanceAsOf(1800000000) == balance);
+
+    CHECK(after->transactions.size() == 3000);
+    CHECK(after->transactionsBetween(0, 1800000000).size() == 3000);
+    CHECK(after->categorySpendingBetween(SpendingCategory::FOOD, 0, 1800000000) == 2998.0 + 7.0);
+    CHECK(after->getCategorySpending().at(SpendingCategory::TRANSPORT) == 5.0);
+    CHECK(after->balanceAsOf(1800000000) == balance - 4.0 + 1.0 - 7.0 + 50.0);
+}
+
+PFM_CASE(description_index_copies_keep_their_postings) {
+    DescriptionIndex index;
+    std::vector<Transaction> rows;
+    for (int i = 0; i < 100; ++i) {
+        rows.emplace_back(IdGenerator::next(), 1.0, SpendingCategory::FOOD, i % 2 ? "coffee shop" : "grocery shop",
+                          1700000000, 0, 0);
+    }
+    for (const auto& trans : rows) {
+        index.add(trans);
+    }
+    index.normalize();
+    DescriptionIndex copy = index;
+
+    index.remove(rows[1]);
+    index.remove(rows[2]);
+    index.add(Transaction(IdGenerator::next(), 1.0, SpendingCategory::FOOD, "coffee beans", 1700000000, 0, 0));
+    index.add(rows[1]);  // out of id order: sorted in by normalize()
+    index.normalize();
+    index.clear();
+    index.add(rows[0]);
+
+    DescriptionIndex::Filter any;
+    CHECK(copy.search("coffee", any, 0).size() == 50);
+    CHECK(copy.search("shop", any, 0).size() == 100);
+    CHECK(copy.search("beans", any, 0).empty());
+    CHECK(copy.size() == 200);
+    CHECK(index.search("shop", any, 0) == std::vector<EntityId>{rows[0].getId()});
+    CHECK(index.search("coffee", any, 0).empty());
+}
+
+// Posting dates keep their sign and full range, so date filters see
+// transactions dated before 1970 as they are.
+PFM_CASE(description_index_filters_dates_before_1970) {
+    DescriptionIndex index;
+    Transaction old(IdGenerator::next(), 1.0, SpendingCategory::HOUSING, "deed", -86400 * 365, 0, 0);
+    Transaction older(IdGenerator::next(), 2.0, SpendingCategory::FOOD, "deed", -86400 * 3650, 0, 0);
+    index.add(old);
+    index.add(older);
+    index.normalize();
+
+    DescriptionIndex::Filter before;
+    before.end = -86400 * 365;
+    CHECK(index.search("deed", before, 0) == std::vector<EntityId>{older.getId()});
+    DescriptionIndex::Filter housing;
+    housing.category = static_cast<int>(SpendingCategory::HOUSING);
+    housing.start = -86400 * 366;
+    CHECK(index.search("deed", housing, 0) == std::vector<EntityId>{old.getId()});
+}
+
+PFM_CASE(string_pool_frees_texts_nobody_uses) {
+    size_t baseline = StringPool::size();
+    {
+        Transaction first(1.0, SpendingCategory::FOOD, "pool test text");
+        Transaction second(2.0, SpendingCategory::FOOD, "pool test text");
+        Transaction copy = first;
+        CHECK(first.getDescriptionRef().key() == second.getDescriptionRef().key());
+        CHECK(StringPool::size() == baseline + 1);
+        first = Transaction(3.0, SpendingCategory::FOOD, "another pool test text");
+        CHECK(StringPool::size() == baseline + 2);
+    }
+    CHECK(StringPool::size() == baseline);
+
+    // Interning races with the release of the last reference.
+    std::atomic<int> garbled{0};
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; ++t) {
+        threads.emplace_back([t, &garbled] {
+            std::mt19937_64 random(t);
+            for (int i = 0; i < 20000; ++i) {
+                std::string text = "shared " + std::to_string(random() % 50);
+                Transaction trans(1.0, SpendingCategory::FOOD, text);
+                garbled += trans.getDescription() != text;
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    CHECK(garbled == 0);
+    CHECK(StringPool::size() == baseline);
+}
+
+PFM_CASE(accounts_are_charged_for_their_descriptions) {
+    size_t baseline = StringPool::size();
+    std::string text(10000, 'x');
+    {
+        Account account("Charged", 0.0);
+        size_t empty = account.estimateMemoryUsage();
+        account.addTransaction(Transaction(1.0, SpendingCategory::FOOD, text));
+        size_t one = account.estimateMemoryUsage();
+        CHECK(one >= empty + text.size());
+        account.addTransaction(Transaction(1.0, SpendingCategory::FOOD, text));
+        CHECK(account.estimateMemoryUsage() < one + text.size());
+        CHECK(StringPool::size() == baseline + 1);
+    }
+    CHECK(StringPool::size() == baseline);
+}
+
+int main(int argc, char* argv[]) {
+    return harness::runMain(argc, argv);
+}
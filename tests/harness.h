@@ -0,0 +1,141 @@
+// Minimal test and benchmark runner shared by tests/ and bench/.
+//
+// Each case runs in a fresh scratch directory, because the application keeps
+// its data under "data/" relative to the working directory. Run a binary with
+// no arguments to run every case, or name the cases to run. FileManager's
+// fault hook is compiled in, and crashAfter() runs code in a child process
+// that dies at a chosen I/O operation.
+#pragma once
+
+#define PFM_NO_MAIN
+#define PFM_FAULT_INJECTION
+#include "../Group_assignment.cpp"
+
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <set>
+#ifndef _WIN32
+#include <sys/wait.h>
+#endif
+
+namespace harness {
+
+struct Case {
+    const char* name;
+    void (*run)(const std::vector<std::string>& args);
+};
+
+inline std::vector<Case>& cases() {
+    static std::vector<Case> instance;
+    return instance;
+}
+
+struct Registrar {
+    Registrar(const char* name, void (*run)(const std::vector<std::string>&)) {
+        cases().push_back(Case{name, run});
+    }
+};
+
+class Failure : public std::runtime_error {
+public:
+    using std::runtime_error::runtime_error;
+};
+
+inline void check(bool ok, const char* expression, const char* file, int line) {
+    if (!ok) {
+        throw Failure(std::string(file) + ":" + std::to_string(line) + ": CHECK(" + expression + ") failed");
+    }
+}
+
+// Wall-clock seconds taken by fn().
+template <typename F>
+double seconds(F&& fn) {
+    auto start = std::chrono::steady_clock::now();
+    fn();
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+// Optional numeric argument at `index`, e.g. a row count for a benchmark.
+inline size_t argument(const std::vector<std::string>& args, size_t index, size_t fallback) {
+    size_t value;
+    if (index < args.size() && parseNumber(args[index], value)) {
+        return value;
+    }
+    return fallback;
+}
+
+#ifndef _WIN32
+// Runs fn() in a forked child that exits as if the machine crashed just
+// before its `operation`-th write, fsync or rename (counting from 1).
+// Returns false when fn() finished before reaching that operation.
+template <typename F>
+bool crashAfter(int operation, F&& fn) {
+    std::fflush(stdout);
+    pid_t pid = fork();
+    if (pid == 0) {
+        int count = 0;
+        FileManager::faultHook() = [&count, operation](const char*, const std::string&) {
+            if (++count == operation) {
+                _exit(0);
+            }
+        };
+        try {
+            fn();
+        } catch (...) {
+            _exit(2);
+        }
+        _exit(1);
+    }
+    int status = 0;
+    waitpid(pid, &status, 0);
+    if (!WIFEXITED(status) || WEXITSTATUS(status) == 2) {
+        throw Failure("crash child failed at operation " + std::to_string(operation));
+    }
+    return WEXITSTATUS(status) == 0;
+}
+#endif
+
+inline int runMain(int argc, char* argv[]) {
+    std::vector<std::string> args(argv + 1, argv + argc);
+    std::string only = args.empty() ? std::string() : args[0];
+    std::vector<std::string> rest(args.size() > 1 ? args.begin() + 1 : args.end(), args.end());
+    std::filesystem::path origin = std::filesystem::current_path();
+    int failures = 0;
+    bool found = false;
+    for (const Case& c : cases()) {
+        if (!only.empty() && only != c.name) {
+            continue;
+        }
+        found = true;
+        std::filesystem::path scratch = std::filesystem::temp_directory_path() /
+                                        ("pfm_" + std::string(c.name) + "_" + std::to_string(IdGenerator::next()));
+        std::filesystem::create_directories(scratch);
+        std::filesystem::current_path(scratch);
+        try {
+            c.run(rest);
+            FileManager::flush();
+            std::printf("PASS %s\n", c.name);
+        } catch (const std::exception& e) {
+            std::printf("FAIL %s: %s\n", c.name, e.what());
+            ++failures;
+        }
+        std::filesystem::current_path(origin);
+        std::error_code ec;
+        std::filesystem::remove_all(scratch, ec);
+    }
+    if (!found) {
+        std::printf("No case named %s\n", only.c_str());
+        return 2;
+    }
+    return failures == 0 ? 0 : 1;
+}
+
+}  // namespace harness
+
+#define PFM_CASE(name)                                                             \
+    static void name(const std::vector<std::string>& args);                       \
+    static harness::Registrar name##_registrar(#name, name);                       \
+    static void name([[maybe_unused]] const std::vector<std::string>& args)
+
+#define CHECK(expression) harness::check(static_cast<bool>(expression), #expression, __FILE__, __LINE__)